@@ -813,6 +813,13 @@ class Commands : public CommandParser {
       return true;
     }
 #endif    
+#if defined(ENABLE_SD) && !defined(DISABLE_FONT_INDEX)
+    if (!strcmp(cmd, "reindex")) {
+      Effect::RemoveIndexes();
+      STDOUT.println("Font index removed, font will be rescanned when loaded.");
+      return true;
+    }
+#endif
 #if 0
     if (!strcmp(cmd, "df")) {
       STDOUT.print(SerialFlashChip::capacity());
@@ -1023,6 +1030,12 @@ class Commands : public CommandParser {
       STDOUT.print("Wav reading: ");
       STDOUT.print(wav_interrupt_cycles * 100.0f / total_cycles);
       STDOUT.println("%");
+#ifdef ENABLE_AUDIO
+      AudioStreamWork::DumpStats();
+      wav_file_cache.Dump();
+      wav_ram_cache.Dump();
+      DumpWavPlayerStats();
+#endif
       STDOUT.print("Pixel DMA: ");
       STDOUT.print(pixel_dma_interrupt_cycles * 100.0f / total_cycles);
       STDOUT.println("%");
@@ -1046,9 +1059,18 @@ class Commands : public CommandParser {
       pixel_dma_interrupt_cycles = 0;
       motion_interrupt_cycles = 0;
       wav_interrupt_cycles = 0;
+#ifdef ENABLE_AUDIO
+      AudioStreamWork::ResetStats();
+#endif
       interrupts();
       return true;
     }
+#ifdef ENABLE_STYLE_PROFILING
+    if (!strcmp(cmd, "style_top")) {
+      DumpStyleProfile();
+      return true;
+    }
+#endif
 #endif
 
     if (!strcmp(cmd, "version")) {
@@ -1344,6 +1366,9 @@ class Commands : public CommandParser {
 #if defined(ENABLE_SD) && !defined(DISABLE_DIAGNOSTIC_COMMANDS)
     STDOUT.println(" dir [directory] - list files on SD card.");
     STDOUT.println(" sdtest - benchmark SD card");
+#endif
+#if defined(ENABLE_SD) && !defined(DISABLE_FONT_INDEX)
+    STDOUT.println(" reindex - rescan current font next time it is loaded");
 #endif
   }
 };
@@ -57,6 +57,12 @@ public:
   // disable power now. (Usually called after is_on()
   // has returned false for some period of time.)
   virtual void allow_disable() = 0;
+
+  // Called by styles instead of setting all the LEDs when the colors
+  // are the same as in the last frame. Returns true if the blade will
+  // keep showing the last frame, otherwise the style has to set all
+  // the LEDs anyways.
+  virtual bool skip_frame() { return false; }
   virtual bool IsPrimary() = 0;
 
   virtual void Activate() = 0;
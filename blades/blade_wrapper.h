@@ -19,6 +19,7 @@ public:
   }
   void clear() override { return blade_->clear(); }
   void allow_disable() override { blade_->allow_disable(); }
+  bool skip_frame() override { return blade_->skip_frame(); }
   void Activate() override { blade_->Activate(); }
   void Deactivate() override { blade_->Deactivate(); }
   bool IsPrimary() override { return blade_->IsPrimary(); }
@@ -21,6 +21,9 @@ public:
   virtual uint8_t get_t0h() = 0;
   virtual uint8_t get_t1h() = 0;
   virtual void set01(uint8_t zero, uint8_t one) = 0;
+  // If non-zero, drive all these pins of pin()'s GPIO port in
+  // parallel, using the proxy (BSRR/BRR) mode.
+  virtual uint16_t gpio_mask() { return 0; }
   WS2811Client* volatile next_ws2811_client_ = nullptr;
 };
 
@@ -66,14 +69,12 @@ public:
     TRACE(BLADE, "kick");
     if (!ws2811_dma_done) return;
     if (!client_) return;
-    PROFFIEOS_ASSERT(color_buffer_size);
     show();
   }
 
   void queue(WS2811Client* client) override {
     TRACE(BLADE, "queue");
     client->next_ws2811_client_ = nullptr;
-    PROFFIEOS_ASSERT(color_buffer_size);
     noInterrupts();
     if (!client_) {
       last_client_ = client_ = client;
@@ -260,7 +261,8 @@ public:
     ws2811_dma_done = false;
     pin_ = pin;
     
-    if (g_PWMInstances[instance] != WS2811_TIMER_INSTANCE) {
+    uint16_t gpio_mask = client->gpio_mask();
+    if (gpio_mask || g_PWMInstances[instance] != WS2811_TIMER_INSTANCE) {
       TRACE(BLADE, "proxy");
       // Proxy mode, make sure GPIO A/B doesn't fall asleep
       RCC->AHB2SMENR |= (RCC_AHB2SMENR_GPIOASMEN | RCC_AHB2SMENR_GPIOBSMEN);
@@ -276,10 +278,10 @@ public:
 	stm32l4_dma_enable(&dma2_, &dma_done_callback_ignore, nullptr);
       }
       stm32l4_dma_enable(&dma3_, &dma_done_callback, (void*)this);
-      uint16_t bit = g_APinDescription[pin].bit;
+      uint16_t bit = gpio_mask ? gpio_mask : g_APinDescription[pin].bit;
       GPIO_TypeDef *GPIO = (GPIO_TypeDef *)(g_APinDescription[pin].GPIO);
       int offset = 0;
-      if (bit > 128) {
+      if (bit > 0xff) {
 	bit >>= 8;
 	offset++;
       }
@@ -499,7 +501,6 @@ public:
     client_->done_callback();
     noInterrupts();
     client_ = client_->next_ws2811_client_;
-    PROFFIEOS_ASSERT( !client_ || color_buffer_size );
     interrupts();
     armv7m_pendsv_enqueue((armv7m_pendsv_routine_t)static_kick, (void *)this, 0);
     TRACE(BLADE, "dma done exit");
@@ -611,6 +612,7 @@ public:
     interrupts();
 
     if (ret >= color_buffer + NELEM(color_buffer)) ret -= NELEM(color_buffer);
+    frame_ = ret;
     return ret;
   }
 
@@ -619,11 +621,15 @@ public:
   }
 
   void EndFrame() override {
-    armv7m_atomic_add(&color_buffer_size, num_leds_);
     TRACE(BLADE, "endframe enter");
-    if (!engine_) return;
+    if (!engine_) {
+      armv7m_atomic_add(&color_buffer_size, num_leds_);
+      return;
+    }
     while (!IsReadyForEndFrame()) armv7m_core_yield();
     frame_num_++;
+    Encode();
+    armv7m_atomic_add(&color_buffer_size, num_leds_);
 
     if (engine_) {
       done_ = false;
@@ -640,6 +646,26 @@ public:
   }
 
 private:
+  // Dithers the frame and replaces each Color16 in the color buffer with
+  // the output bytes in wire order, so that read(), which runs in the DMA
+  // interrupt, only has to look up bit patterns.
+  void Encode() __attribute__((optimize("Ofast"))) {
+    static_assert(sizeof(Color16) >= 4, "not enough room for encoded bytes");
+    Color16* pos = frame_;
+    for (int i = 0; i < num_leds_; i++) {
+      Color8 color = pos->dither(frame_num_, pos - color_buffer);
+      uint8_t* bytes = (uint8_t*)pos;
+      if (Color8::inline_num_bytes(BYTEORDER) == 4) {
+	*(bytes++) = GETBYTE<BYTEORDER, 3>(color);
+      }
+      *(bytes++) = GETBYTE<BYTEORDER, 2>(color);
+      *(bytes++) = GETBYTE<BYTEORDER, 1>(color);
+      *(bytes++) = GETBYTE<BYTEORDER, 0>(color);
+      pos++;
+      if (pos == color_buffer + NELEM(color_buffer)) pos = color_buffer;
+    }
+  }
+
   void done_callback() override {
     done_time_us_ = micros();
     done_ = true;
@@ -648,31 +674,12 @@ private:
   void read(uint8_t* dest) override __attribute__((optimize("Ofast"))) {
     PROFFIEOS_ASSERT(color_buffer_size);
     Color16* pos = color_buffer_ptr;
+    const uint8_t* bytes = (const uint8_t*)pos;
     uint32_t* output = (uint32_t*) dest;
-    Color8 color = pos->dither(frame_num_, pos - color_buffer);
-#if 0    
-    for (int i = Color8::inline_num_bytes(BYTEORDER) - 1; i >= 0; i--) {
-      uint32_t tmp = color.inline_getByte(BYTEORDER, i) * 0x8040201U;
-      *(output++) = zero4X_ + ((tmp >> 7) & 0x01010101U) * one_minus_zero_;
-      *(output++) = zero4X_ + ((tmp >> 3) & 0x01010101U) * one_minus_zero_;
+    for (int i = 0; i < Color8::inline_num_bytes(BYTEORDER); i++) {
+      *(output++) = nibble_bits_[bytes[i] >> 4];
+      *(output++) = nibble_bits_[bytes[i] & 0xf];
     }
-#else
-    uint32_t tmp;
-    if (Color8::inline_num_bytes(BYTEORDER) == 4) {
-      tmp = GETBYTE<BYTEORDER, 3>(color) * 0x8040201U;
-      *(output++) = zero4X_ ^ ((tmp >> 7) & 0x01010101U) * one_minus_zero_;
-      *(output++) = zero4X_ ^ ((tmp >> 3) & 0x01010101U) * one_minus_zero_;
-    }
-    tmp = GETBYTE<BYTEORDER, 2>(color) * 0x8040201U;
-    *(output++) = zero4X_ ^ ((tmp >> 7) & 0x01010101U) * one_minus_zero_;
-    *(output++) = zero4X_ ^ ((tmp >> 3) & 0x01010101U) * one_minus_zero_;
-    tmp = GETBYTE<BYTEORDER, 1>(color) * 0x8040201U;
-    *(output++) = zero4X_ ^ ((tmp >> 7) & 0x01010101U) * one_minus_zero_;
-    *(output++) = zero4X_ ^ ((tmp >> 3) & 0x01010101U) * one_minus_zero_;
-    tmp = GETBYTE<BYTEORDER, 0>(color) * 0x8040201U;
-    *(output++) = zero4X_ ^ ((tmp >> 7) & 0x01010101U) * one_minus_zero_;
-    *(output++) = zero4X_ ^ ((tmp >> 3) & 0x01010101U) * one_minus_zero_;
-#endif
     pos++;
     if (pos == color_buffer + NELEM(color_buffer)) pos = color_buffer;
     armv7m_atomic_sub(&color_buffer_size, 1);
@@ -687,9 +694,16 @@ private:
   int frequency() override { return frequency_; }
   int num_leds() override { return num_leds_; }
 
+  // Builds the table used by read(), which maps four bits (MSB first)
+  // to four output bytes.
   void set01(uint8_t zero, uint8_t one) override {
-    zero4X_ = zero * 0x01010101;
-    one_minus_zero_ = one ^ zero;
+    for (int n = 0; n < 16; n++) {
+      uint32_t bits = 0;
+      for (int b = 0; b < 4; b++) {
+	bits |= (uint32_t)((n << b) & 8 ? one : zero) << (b * 8);
+      }
+      nibble_bits_[n] = bits;
+    }
   }
 
   uint8_t get_t0h() override { return t0h_; }
@@ -707,8 +721,9 @@ private:
   uint8_t t0h_;
   uint8_t t1h_;
 
-  uint32_t one_minus_zero_;
-  uint32_t zero4X_;
+  uint32_t nibble_bits_[16];
+  // Start of the frame in color_buffer, set by BeginFrame().
+  Color16* frame_;
 
   volatile bool done_ = true;
   volatile uint32_t done_time_us_ = 0;
@@ -720,5 +735,299 @@ public:
   WS2811Pin() : WS2811PinBase<BYTEORDER>(LEDS, PIN, frequency, reset_us, t0h, t1h) {}
 };
 
+// Parallel output.
+// Up to 8 strips connected to the same GPIO port, and to the same half of
+// that port (pins 0-7 or 8-15), can be sent at the same time by a single
+// DMA stream writing to the port's BRR register. Sending all of them takes
+// as long as the longest strip, instead of the sum of all strips.
+// All parallel strips must use the same frequency, timing and number of
+// bytes per LED. Shorter strips are padded with black LEDs. Strips that
+// can't be sent together are put in separate groups, which are sent one
+// after the other, like normal WS2811 pins.
+// Usage: pass WS2811ParallelPin as the PinClass to WS2811BladePtr, like:
+//   WS2811BladePtr<144, WS2811_GRB, bladePin, PowerPINS<bladePowerPin2, bladePowerPin3>, WS2811ParallelPin>()
+class WS2811ParallelPinBase;
+
+class WS2811ParallelGroup : public WS2811Client, Looper {
+public:
+  static const int kMaxPins = 8;
+  WS2811ParallelGroup() : Looper() {}
+  const char* name() override { return "WS2811ParallelGroup"; }
+
+  // Returns false if |pin| can't be sent together with the
+  // pins already in this group.
+  bool Add(WS2811ParallelPinBase* pin);
+
+  bool IsReady() {
+    MaybeSend();
+    return !busy_ && (micros() - done_time_us_) > reset_us_;
+  }
+  // Called by a pin when it has a new frame. We wait for the other
+  // pins for up to one send time, so that they can share the transfer.
+  void FrameReady() {
+    if (!waiting_) {
+      waiting_ = true;
+      wait_start_us_ = micros();
+    }
+    MaybeSend();
+    Wake();
+  }
+  void MaybeSend();
+
+  // WS2811Client implementation
+  void done_callback() override;
+  int chunk_size() override;
+  int pin() override;
+  int frequency() override;
+  int num_leds() override;
+  void read(uint8_t* dest) override __attribute__((optimize("Ofast")));
+  uint8_t get_t0h() override;
+  uint8_t get_t1h() override;
+  void set01(uint8_t zero, uint8_t one) override;
+  uint16_t gpio_mask() override;
+
+protected:
+  void Loop() override {
+    MaybeSend();
+    // Nothing to do until a pin has a frame, or the transfer is done.
+    if (!waiting_ || busy_) Suspend();
+  }
+
+private:
+  WS2811ParallelPinBase* pins_[kMaxPins];
+  int num_pins_ = 0;
+  // Next LED to read(), reset in set01(), which show() calls first.
+  int led_ = 0;
+  uint32_t reset_us_ = 300;
+  volatile bool busy_ = false;
+  volatile uint32_t done_time_us_ = 0;
+  bool waiting_ = false;
+  uint32_t wait_start_us_ = 0;
+  uint32_t send_start_us_ = 0;
+  volatile uint32_t send_us_ = 0;
+};
+
+// Returns the first group that |pin| can be added to.
+// Returns nullptr if there is none, the pin will not be able to show
+// anything, but it won't block the other blades either.
+WS2811ParallelGroup* GetWS2811ParallelGroup(WS2811ParallelPinBase* pin) {
+  static WS2811ParallelGroup groups[3];
+  for (size_t i = 0; i < NELEM(groups); i++) {
+    if (groups[i].Add(pin)) return groups + i;
+  }
+  return nullptr;
+}
+
+class WS2811ParallelPinBase : public WS2811PIN {
+public:
+  WS2811ParallelPinBase(int num_leds, int8_t pin, int frequency, int reset_us,
+			int t0h_us, int t1h_us, int num_bytes, Color16* frame) {
+    pin_ = pin;
+    num_leds_ = num_leds;
+    frequency_ = frequency;
+    reset_us_ = reset_us;
+    num_bytes_ = num_bytes;
+    frame_ = frame;
+    int pulse_len = timer_frequency / frequency;
+    t0h_ = pulse_len * t0h_us / 1250;
+    t1h_ = pulse_len * t1h_us / 1250;
+    group_ = GetWS2811ParallelGroup(this);
+  }
+
+  bool IsReadyForBeginFrame() override {
+    if (!group_) return true;
+    // The DMA reads straight from frame_, so it can't be touched until
+    // the previous frame has been sent.
+    group_->MaybeSend();
+    return !pending_;
+  }
+
+  Color16* BeginFrame() override {
+    while (!IsReadyForBeginFrame()) armv7m_core_yield();
+    return frame_;
+  }
+
+  bool IsReadyForEndFrame() override {
+    if (!group_) return true;
+    return !pending_ && group_->IsReady();
+  }
+
+  void EndFrame() override {
+    if (!group_) {
+      if (!warned_) {
+	STDOUT << "Pin " << (int)pin_ << " does not fit in any parallel WS2811 group.\n";
+	warned_ = true;
+      }
+      return;
+    }
+    frame_num_++;
+    Encode();
+    pending_ = true;
+    group_->FrameReady();
+  }
+
+  int num_leds() const override { return num_leds_; }
+  void Enable(bool on) override {
+    pinMode(pin_, on ? OUTPUT : INPUT_ANALOG);
+    enabled_ = on;
+  }
+
+  // Builds the table used by the group's read(). Bits that are zero
+  // should pull the pin low at t0h, ones are left alone until t1h.
+  void set01(uint8_t zero) {
+    for (int n = 0; n < 16; n++) {
+      uint32_t bits = 0;
+      for (int b = 0; b < 4; b++) {
+	if (!((n << b) & 8)) bits |= (uint32_t)zero << (b * 8);
+      }
+      nibble_bits_[n] = bits;
+    }
+  }
+
+protected:
+  // Dithers the frame and replaces each Color16 with the output bytes
+  // in wire order.
+  virtual void Encode() = 0;
+
+  friend class WS2811ParallelGroup;
+  WS2811ParallelGroup* group_;
+  Color16* frame_;
+  int8_t pin_;
+  uint8_t frame_num_ = 0;
+  uint8_t num_bytes_;
+  uint16_t num_leds_;
+  int frequency_;
+  uint32_t reset_us_;
+  uint8_t t0h_;
+  uint8_t t1h_;
+  uint32_t nibble_bits_[16];
+  // A new frame is waiting to be sent.
+  volatile bool pending_ = false;
+  bool enabled_ = false;
+  bool warned_ = false;
+};
+
+bool WS2811ParallelGroup::Add(WS2811ParallelPinBase* pin) {
+  if (num_pins_ == kMaxPins) return false;
+  if (num_pins_) {
+    WS2811ParallelPinBase* first = pins_[0];
+    // One DMA stream writes one byte of the port, so all
+    // pins must be on the same half of the same port.
+    if (g_APinDescription[pin->pin_].GPIO != g_APinDescription[first->pin_].GPIO ||
+	(g_APinDescription[pin->pin_].bit > 0xff) != (g_APinDescription[first->pin_].bit > 0xff)) {
+      return false;
+    }
+    if (pin->frequency_ != first->frequency_ ||
+	pin->num_bytes_ != first->num_bytes_ ||
+	pin->t0h_ != first->t0h_ ||
+	pin->t1h_ != first->t1h_) {
+      return false;
+    }
+  }
+  pins_[num_pins_++] = pin;
+  // The longest reset time works for all of the strips.
+  reset_us_ = std::max<uint32_t>(reset_us_, pin->reset_us_);
+  return true;
+}
+
+void WS2811ParallelGroup::MaybeSend() {
+  if (busy_ || !waiting_) return;
+  bool all = true;
+  for (int i = 0; i < num_pins_; i++) {
+    if (pins_[i]->enabled_ && !pins_[i]->pending_) all = false;
+  }
+  if (!all && micros() - wait_start_us_ < send_us_) return;
+  if ((micros() - done_time_us_) <= reset_us_) return;
+  waiting_ = false;
+  busy_ = true;
+  send_start_us_ = micros();
+  GetWS2811Engine(pins_[0]->pin_)->queue(this);
+}
+
+void WS2811ParallelGroup::done_callback() {
+  uint32_t now = micros();
+  for (int i = 0; i < num_pins_; i++) pins_[i]->pending_ = false;
+  send_us_ = now - send_start_us_;
+  done_time_us_ = now;
+  busy_ = false;
+  Wake();
+}
+
+int WS2811ParallelGroup::chunk_size() { return pins_[0]->num_bytes_ * 8; }
+int WS2811ParallelGroup::pin() { return pins_[0]->pin_; }
+int WS2811ParallelGroup::frequency() { return pins_[0]->frequency_; }
+uint8_t WS2811ParallelGroup::get_t0h() { return pins_[0]->t0h_; }
+uint8_t WS2811ParallelGroup::get_t1h() { return pins_[0]->t1h_; }
+
+int WS2811ParallelGroup::num_leds() {
+  int ret = 0;
+  for (int i = 0; i < num_pins_; i++) ret = std::max<int>(ret, pins_[i]->num_leds_);
+  return ret;
+}
+
+uint16_t WS2811ParallelGroup::gpio_mask() {
+  uint16_t mask = 0;
+  for (int i = 0; i < num_pins_; i++) mask |= g_APinDescription[pins_[i]->pin_].bit;
+  return mask;
+}
+
+void WS2811ParallelGroup::set01(uint8_t zero, uint8_t one) {
+  for (int i = 0; i < num_pins_; i++) {
+    uint16_t bit = g_APinDescription[pins_[i]->pin_].bit;
+    if (bit > 0xff) bit >>= 8;
+    pins_[i]->set01(bit);
+  }
+  led_ = 0;
+}
+
+void WS2811ParallelGroup::read(uint8_t* dest) {
+  uint32_t* output = (uint32_t*) dest;
+  int num_bytes = pins_[0]->num_bytes_;
+  for (int b = 0; b < num_bytes; b++) {
+    uint32_t high = 0;
+    uint32_t low = 0;
+    for (int i = 0; i < num_pins_; i++) {
+      WS2811ParallelPinBase* pin = pins_[i];
+      // Past the end of a strip, send black.
+      uint8_t byte = led_ < pin->num_leds_ ? ((uint8_t*)(pin->frame_ + led_))[b] : 0;
+      high |= pin->nibble_bits_[byte >> 4];
+      low |= pin->nibble_bits_[byte & 0xf];
+    }
+    *(output++) = high;
+    *(output++) = low;
+  }
+  led_++;
+}
+
+template<int LEDS, int PIN, Color8::Byteorder BYTEORDER, int frequency=800000, int reset_us=300, int t0h=294, int t1h=892>
+class WS2811ParallelPin : public WS2811ParallelPinBase {
+  static_assert(PIN >= 0, "WS2811ParallelPin needs a real pin");
+  static_assert(t0h > 0 && t0h < t1h && t1h < 1250,
+		"WS2811ParallelPin timing must be 0 < t0h < t1h < 1250");
+  static_assert(frequency > 0 && reset_us > 0, "bad WS2811ParallelPin timing");
+public:
+  WS2811ParallelPin() :
+    WS2811ParallelPinBase(LEDS, PIN, frequency, reset_us, t0h, t1h,
+			  Color8::num_bytes(BYTEORDER), frame_buffer_) {}
+  Color8::Byteorder get_byteorder() const override { return BYTEORDER; }
+
+protected:
+  void Encode() override __attribute__((optimize("Ofast"))) {
+    for (int i = 0; i < LEDS; i++) {
+      Color8 color = frame_buffer_[i].dither(frame_num_, i);
+      uint8_t* bytes = (uint8_t*)(frame_buffer_ + i);
+      if (Color8::inline_num_bytes(BYTEORDER) == 4) {
+	*(bytes++) = GETBYTE<BYTEORDER, 3>(color);
+      }
+      *(bytes++) = GETBYTE<BYTEORDER, 2>(color);
+      *(bytes++) = GETBYTE<BYTEORDER, 1>(color);
+      *(bytes++) = GETBYTE<BYTEORDER, 0>(color);
+    }
+  }
+
+private:
+  Color16 frame_buffer_[LEDS];
+};
+
 #endif
 
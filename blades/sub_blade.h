@@ -11,6 +11,8 @@ public:
     return blade_->set_overdrive(led + offset_, c);
   }
   void allow_disable() override { allow_disable_ = true; }
+  // All sub-blades share one frame.
+  bool skip_frame() override { return false; }
 
   bool active_ = false;
   bool SomeSubBladeIsActive() {
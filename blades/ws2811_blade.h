@@ -10,7 +10,6 @@
 #endif
 
 Color16 color_buffer[maxLedsPerStrip + EXTRA_COLOR_BUFFER_SPACE];
-BladeBase* current_blade = NULL;
 
 class WS2811PIN {
 public:
@@ -46,52 +45,70 @@ DMAMEM int displayMemory[maxLedsPerStrip * 24 / 4 + 1];
 // WS2811-type blade implementation.
 // Note that this class does nothing when first constructed. It only starts
 // interacting with pins and timers after Activate() is called.
+// Each blade renders its style into its own frame buffer, so blades can
+// compute new frames while other pins are still busy sending. Once the pin
+// is ready, the frame is copied into the pin's output buffer in one go.
 class WS2811_Blade : public AbstractBlade, CommandParser, Looper {
 public:
 WS2811_Blade(WS2811PIN* pin,
              PowerPinInterface* power,
-             uint32_t poweroff_delay_ms) :
+             uint32_t poweroff_delay_ms,
+             bool error_diffusion = false) :
     AbstractBlade(),
     CommandParser(NOLINK),
     Looper(NOLINK),
     poweroff_delay_ms_(poweroff_delay_ms),
+    error_diffusion_(error_diffusion),
     power_(power),
     pin_(pin) {
     }
   const char* name() override { return "WS2811_Blade"; }
 
+  // Copies |frame| (or black if null) to the pin and starts sending it.
+  // This is also where the error diffusion moves on to the next frame,
+  // so it has to be called every frame, even if the style skipped it.
+  // Does not yield between BeginFrame() and EndFrame(), so no other
+  // blade can claim the same part of the pin output buffer.
+  void ShowFrame(const Color16* frame) {
+    Color16* out = pin_->BeginFrame();
+    Color16* buffer_end = color_buffer + NELEM(color_buffer);
+    int num_leds = pin_->num_leds();
+    for (int i = 0; i < num_leds; i++) {
+      if (!frame) {
+	*out = Color16();
+      } else if (residual_) {
+	*out = frame[i].diffuse(residual_ + i * 3);
+      } else {
+	*out = frame[i];
+      }
+      if (++out == buffer_end) out = color_buffer;
+    }
+    pin_->EndFrame();
+  }
+
   void Power(bool on) {
     if (on) EnableBooster();
     if (!powered_ && on) {
       power_->Init();
       TRACE(BLADE, "Power on");
       pin_->Enable(true);
-      colors_ = pin_->BeginFrame();
-      for (int i = 0; i < pin_->num_leds(); i++) set(i, Color16());
       while (!pin_->IsReadyForEndFrame()) ProffieOS_yield();
       power_->Power(on);
-      pin_->EndFrame();
-      colors_ = pin_->BeginFrame();
-      for (int i = 0; i < pin_->num_leds(); i++) set(i, Color16());
-      pin_->EndFrame();
-      colors_ = pin_->BeginFrame();
-      for (int i = 0; i < pin_->num_leds(); i++) set(i, Color16());
-      pin_->EndFrame();
-      current_blade = NULL;
+      ShowFrame(nullptr);
+      ShowFrame(nullptr);
+      ShowFrame(nullptr);
     } else if (powered_ && !on) {
       TRACE(BLADE, "Power off");
-      colors_ = pin_->BeginFrame();
-      for (int i = 0; i < pin_->num_leds(); i++) set(i, Color16());
-      pin_->EndFrame();
+      ShowFrame(nullptr);
       // Wait until it's sent before powering off.
       while (!pin_->IsReadyForEndFrame())  ProffieOS_yield();
       power_->Power(on);
       pin_->Enable(false);
       power_->DeInit();
-      current_blade = NULL;
     }
     powered_ = on;
     allow_disable_ = false;
+    frame_valid_ = false;
   }
 
   void Activate() override {
@@ -99,6 +116,8 @@ WS2811_Blade(WS2811PIN* pin,
     STDOUT.print("WS2811 Blade with ");
     STDOUT.print(pin_->num_leds());
     STDOUT.println(" leds.");
+    if (!frame_) frame_ = new Color16[pin_->num_leds()];
+    if (error_diffusion_ && !residual_) residual_ = new uint8_t[pin_->num_leds() * 3]();
     run_ = true;
     CommandParser::Link();
     Looper::Link();
@@ -111,6 +130,10 @@ WS2811_Blade(WS2811PIN* pin,
     CommandParser::Unlink();
     Looper::Unlink();
     AbstractBlade::Deactivate();
+    delete[] frame_;
+    frame_ = nullptr;
+    delete[] residual_;
+    residual_ = nullptr;
   }
   // BladeBase implementation
   int num_leds() const override {
@@ -123,17 +146,19 @@ WS2811_Blade(WS2811PIN* pin,
     return on_;
   }
   void set(int led, Color16 c) override {
-    Color16* pos = colors_ + led;
-    if (pos >= color_buffer + NELEM(color_buffer)) pos -= NELEM(color_buffer);
-    *pos = c;
+    frame_[led] = c;
   }
   void allow_disable() override {
     if (!on_) allow_disable_ = true;
   }
+  bool skip_frame() override {
+    return frame_valid_;
+  }
   void SetStyle(BladeStyle* style) override{
     TRACE(BLADE, "SetStyle");
     AbstractBlade::SetStyle(style);
     run_ = true;
+    frame_valid_ = false;
   }
   BladeStyle* UnSetStyle() override {
     TRACE(BLADE, "UnSetStyle");
@@ -167,7 +192,14 @@ WS2811_Blade(WS2811PIN* pin,
   void SB_Top(uint64_t total_cycles) override {
     STDOUT.print("blade fps: ");
     loop_counter_.Print();
+    if (frames_rendered_) {
+      STDOUT << " render: " << (render_micros_ / frames_rendered_) << "us"
+	     << " pin wait: " << (wait_micros_ / frames_rendered_) << "us";
+    }
     STDOUT.println("");
+    frames_rendered_ = 0;
+    render_micros_ = 0;
+    wait_micros_ = 0;
   }
 
   bool Parse(const char* cmd, const char* arg) override {
@@ -199,47 +231,43 @@ WS2811_Blade(WS2811PIN* pin,
     power_off_requested_ = false;
   }
 
-#define BLADE_YIELD() do {			\
-  YIELD();					\
-  /* If Power() was called.... */		\
-  if (current_blade != this) goto retry;	\
-} while(0)
-			     
 protected:
   void Loop() override {
     STATE_MACHINE_BEGIN();
     while (true) {
-    retry:
-      if (current_blade == this) current_blade = NULL;
       YIELD();
-      if (!current_style_ || !run_) {
+      if (!current_style_ || !run_ || !frame_) {
 	loop_counter_.Reset();
 	continue;
       }
-      // Wait until it's our turn.
-      if (current_blade) {
-	continue;
-      }
-      current_blade = this;
       if (power_off_requested_) {
 	PowerOff();
 	continue;
       }
 
-      // Update pixels
-      while (!pin_->IsReadyForBeginFrame()) BLADE_YIELD();
-      colors_ = pin_->BeginFrame();
-      
+      // Render the next frame. This only touches our own frame buffer,
+      // so it can overlap with other pins sending their frames.
       allow_disable_ = false;
+      start_micros_ = micros();
       current_style_->run(this);
+      render_micros_ += micros() - start_micros_;
+      frames_rendered_++;
 
       if (!powered_) {
 	if (allow_disable_) continue;
 	Power(true);
       }
 
-      while (!pin_->IsReadyForEndFrame()) BLADE_YIELD();
-      pin_->EndFrame();
+      // Even if the style skipped this frame, frame_ is sent again,
+      // the dithering changes from frame to frame.
+      // Pace ourselves to what this pin can show.
+      start_micros_ = micros();
+      while (!pin_->IsReadyForEndFrame() || !pin_->IsReadyForBeginFrame()) YIELD();
+      wait_micros_ += micros() - start_micros_;
+      // Power(false) may have been called while we were waiting.
+      if (!powered_) continue;
+      ShowFrame(frame_);
+      frame_valid_ = true;
       loop_counter_.Update();
 
       if (powered_ && allow_disable_) {
@@ -261,13 +289,24 @@ private:
   bool allow_disable_ = false;
   // We should power off and stop running, even if the blade is on.
   bool power_off_requested_ = false;
+  // frame_ holds the last frame that the style generated.
+  bool frame_valid_ = false;
   uint32_t poweroff_delay_ms_;
   uint32_t poweroff_delay_start_ = 0;
+  // Use temporal error diffusion instead of ordered dithering.
+  bool error_diffusion_;
   LoopCounter loop_counter_;
+  uint32_t start_micros_;
+  uint32_t render_micros_ = 0;
+  uint32_t wait_micros_ = 0;
+  uint32_t frames_rendered_ = 0;
   StateMachineState state_machine_;
   PowerPinInterface* power_;
   WS2811PIN* pin_;
-  Color16* colors_;
+  // Frame being rendered by the style, allocated in Activate().
+  Color16* frame_ = nullptr;
+  // Error diffusion remainders, three per LED.
+  uint8_t* residual_ = nullptr;
 };
 
 
@@ -282,6 +321,10 @@ private:
 #define WS2811_580kHz 0x30      // PL9823
 #define WS2811_ACTUALLY_800kHz 0x40      // Normally we use 740kHz instead of 800, this uses 800.
 
+// Use temporal error diffusion instead of ordered dithering for this blade.
+// Reduces banding and flicker at low brightness, costs 3 bytes of RAM per LED.
+#define WS2811_ERROR_DIFFUSION 0x100
+
 constexpr Color8::Byteorder ByteOrderFromFlags(int CONFIG) {
   return
     (CONFIG & 0xf) == WS2811_RGB ? Color8::RGB :
@@ -307,7 +350,8 @@ class BladeBase *WS2811BladePtr() {
   static_assert(LEDS <= maxLedsPerStrip, "update maxLedsPerStrip");
   static POWER_PINS power_pins;
   static PinClass<LEDS, DATA_PIN, ByteOrderFromFlags(CONFIG), FrequencyFromFlags(CONFIG), reset_us, t0h, t1h> pin;
-  static WS2811_Blade blade(&pin, &power_pins, POWER_OFF_DELAY_MS);
+  static WS2811_Blade blade(&pin, &power_pins, POWER_OFF_DELAY_MS,
+			    (CONFIG & WS2811_ERROR_DIFFUSION) != 0);
   return &blade;
 }
 
@@ -552,8 +552,44 @@ TEST(TwoButtonClickTest2) {
   STATE_MACHINE_END();
 }
 
-int main() {
+class CountingLooper : public Looper {
+public:
+  const char* name() override { return "CountingLooper"; }
+  void Loop() override {
+    calls_++;
+    if (suspend_) Suspend();
+  }
+  using Looper::SetPeriod;
+  int calls_ = 0;
+  bool suspend_ = false;
+};
+
+bool TestLooperScheduling() {
   bool pass = true;
+  CountingLooper every_loop;
+  CountingLooper periodic;
+  CountingLooper suspended;
+  periodic.SetPeriod(1000);
+  suspended.suspend_ = true;
+  micros_ = 0;
+  for (int i = 0; i < 100; i++) {
+    micros_ += 100;
+    Looper::DoLoop();
+    if (i == 50) suspended.Wake();
+  }
+  if (every_loop.calls_ != 100) pass = false;
+  // Once right away, then at 1ms, 2ms ... 10ms.
+  if (periodic.calls_ != 11) pass = false;
+  if (suspended.calls_ != 2) pass = false;
+  if (!pass) {
+    fprintf(stderr, "Looper scheduling: %d %d %d\n",
+            every_loop.calls_, periodic.calls_, suspended.calls_);
+  }
+  return pass;
+}
+
+int main() {
+  bool pass = TestLooperScheduling();
   for (current_test_ = all_tests_; current_test_; current_test_ = current_test_->next_) {
     fprintf(stderr, "Running %s\n", current_test_->name());
     micros_ = 0;
@@ -59,7 +59,16 @@ protected:
     STATE_MACHINE_BEGIN();
     last_voltage_read_time_ = micros();
     while (true) {
-      while (micros() - last_voltage_read_time_ < 1000) YIELD();
+      // Voltage is read once per millisecond. Sleep until the next
+      // reading is due, then check on the ADC on every loop.
+      while (true) {
+        {
+          uint32_t elapsed = micros() - last_voltage_read_time_;
+          if (elapsed >= 1000) break;
+          SleepMicros(1000 - elapsed);
+        }
+        YIELD();
+      }
       while (!reader_.Start()) YIELD();
       while (!reader_.Done()) YIELD();
       float v = battery_now();
@@ -248,6 +248,24 @@ class Color16 {
     return dither(color16_dither_matrix[x & 3][y & 3]);
   }
 
+  // Temporal error diffusion. |residual| holds three bytes per LED with
+  // the part of each channel that was rounded away in the previous frame.
+  // Over several frames, the average output matches the 16-bit input,
+  // even at very low brightness. The result is in the middle of an 8-bit
+  // step, so dither() above will not change it.
+  Color16 diffuse(uint8_t* residual) const {
+    return Color16(diffuse_channel(r, residual),
+		   diffuse_channel(g, residual + 1),
+		   diffuse_channel(b, residual + 2));
+  }
+
+  static uint16_t diffuse_channel(uint16_t c, uint8_t* residual) {
+    uint32_t v = c + *residual;
+    uint32_t out = std::min<uint32_t>(v >> 8, 255);
+    *residual = std::min<uint32_t>(v - (out << 8), 255);
+    return (out << 8) + 128;
+  }
+
   uint16_t getShort(int byteorder, int byte) {
     switch (byteorder >> (byte * 4) & 0x7) {
       default: return r;
@@ -407,6 +425,7 @@ inline Color16 operator+(const Color16& a, const Color16 &b) {
 
 // Unmultiplied RGBA (no overdrive), used as a temporary and makes optimization easier.
 struct RGBA_um_nod {
+  RGBA_um_nod() {}
   constexpr RGBA_um_nod(Color16 c_, uint16_t a) : c(c_), alpha(a) {}
   constexpr RGBA_um_nod(const SimpleColor& c_) : c(c_.c), alpha(32768) {}
   static RGBA_um_nod Transparent() { return RGBA_um_nod(Color16(), 0); }
@@ -423,6 +442,7 @@ struct RGBA_um_nod {
 
 // Unmultiplied RGBA, used as a temporary and makes optimization easier.
 struct RGBA_um {
+  RGBA_um() {}
   constexpr RGBA_um(Color16 c_, bool od, uint16_t a) : c(c_), alpha(a), overdrive(od) {}
   constexpr RGBA_um(const RGBA_um_nod& o) : c(o.c), alpha(o.alpha), overdrive(false) {}
   constexpr RGBA_um(const OverDriveColor& o) : c(o.c), alpha(32768), overdrive(o.overdrive) {}
@@ -443,6 +463,7 @@ struct RGBA_um {
 
 // Premultiplied ALPHA, no overdrive
 struct RGBA_nod {
+  RGBA_nod() {}
   constexpr RGBA_nod(Color16 c_, uint16_t a) : c(c_), alpha(a) {}
   RGBA_nod(const RGBA_um_nod& rgba) : c(rgba.c * rgba.alpha >> 15), alpha(rgba.alpha)  {}
   RGBA_nod(const SimpleColor& o) : c(o.c), alpha(32768) {}
@@ -458,6 +479,7 @@ struct RGBA_nod {
 
 // Premultiplied ALPHA
 struct RGBA {
+  RGBA() {}
   constexpr RGBA(Color16 c_, bool od, uint16_t a) : c(c_), alpha(a), overdrive(od) {}
   RGBA(const RGBA_nod& rgba) : c(rgba.c * rgba.alpha >> 15), alpha(rgba.alpha), overdrive(false)  {}
   RGBA(const RGBA_um& rgba) : c(rgba.c * rgba.alpha >> 15), alpha(rgba.alpha), overdrive(rgba.overdrive)  {}
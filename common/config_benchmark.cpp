@@ -0,0 +1,232 @@
+// Host-side benchmark for ConfigFile::Read().
+//
+// Generates a font config.ini with the same variables as FontConfigFile,
+// including the per-effect ProffieOS.SFX.* variables, then reads it
+// with ConfigFile::Read() and with the old line-by-line SetVariable()
+// loop, checks that both give the same values and prints the time
+// per read for each.
+//
+// Usage: ./config_benchmark [-n reads] [-effects N]
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <stdint.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <memory.h>
+
+// cruft
+#define PROFFIE_TEST
+#define ENABLE_SD
+
+const char install_time[] = __DATE__ " " __TIME__;
+const char* GetSaveDir() { return NULL; }
+uint32_t micros() { return 0; }
+uint32_t millis() { return 0; }
+#include "strfun.h"
+
+class Looper {
+public:
+  virtual const char* name() = 0;
+  virtual void Loop() = 0;
+  static void DoHFLoop() {}
+};
+
+char* itoa( int value, char *ret, int radix )
+{
+  sprintf(ret, "%d", value);
+  return ret;
+}
+
+#include "linked_ptr.h"
+#include "lsfs.h"
+
+#define LOCK_SD(X) do { } while(0)
+#define noInterrupts() do{}while(0)
+#define interrupts() do{}while(0)
+#define SCOPED_PROFILER() do { } while(0)
+
+#include "stdout.h"
+#include "monitoring.h"
+Monitoring monitor;
+Print* default_output;
+Print* stdout_output;
+ConsoleHelper STDOUT;
+
+const char* current_directory = nullptr;
+const char* next_current_directory(const char* dir) { return nullptr; }
+#include "config_file.h"
+
+struct Effect {
+  std::string name;
+  float paired;
+  int volume;
+};
+std::vector<Effect> effects;
+
+// Same variables as FontConfigFile.
+struct BenchConfig : public ConfigFile {
+  void iterateVariables(VariableOP *op) override {
+    CONFIG_VARIABLE2(humStart, 100);
+    CONFIG_VARIABLE2(volHum, 15);
+    CONFIG_VARIABLE2(volEff, 16);
+    CONFIG_VARIABLE2(ProffieOSSwingSpeedThreshold, 250.0f);
+    CONFIG_VARIABLE2(ProffieOSSwingVolumeSharpness, 0.5f);
+    CONFIG_VARIABLE2(ProffieOSMaxSwingVolume, 2.0f);
+    CONFIG_VARIABLE2(ProffieOSSwingOverlap, 0.5f);
+    CONFIG_VARIABLE2(ProffieOSSmoothSwingDucking, 0.2f);
+    CONFIG_VARIABLE2(ProffieOSSwingLowerThreshold, 200.0f);
+    CONFIG_VARIABLE2(ProffieOSSlashAccelerationThreshold, 130.0f);
+    CONFIG_VARIABLE2(ProffieOSAnimationFrameRate, 0.0f);
+    CONFIG_VARIABLE2(ProffieOSFontImageDuration, 5000.0f);
+    CONFIG_VARIABLE2(ProffieOSOnImageDuration, 5000.0f);
+    CONFIG_VARIABLE2(ProffieOSBlastImageDuration, 1000.0f);
+    CONFIG_VARIABLE2(ProffieOSClashImageDuration, 500.0f);
+    CONFIG_VARIABLE2(ProffieOSForceImageDuration, 1000.0f);
+    CONFIG_VARIABLE2(ProffieOSMinSwingAcceleration, 0.0f);
+    CONFIG_VARIABLE2(ProffieOSMaxSwingAcceleration, 0.0f);
+    CONFIG_VARIABLE2(ProffieOSSpinDegrees, 360.0f);
+    for (Effect& e : effects) {
+      char name[64];
+      sprintf(name, "ProffieOS.SFX.%s.paired", e.name.c_str());
+      DoVariableOp(op, name, e.paired, 0.0f);
+      sprintf(name, "ProffieOS.SFX.%s.volume", e.name.c_str());
+      DoVariableOp(op, name, e.volume, 100);
+    }
+  }
+
+  // The way Read() used to work: one pass over all variables per line.
+  ReadStatus LinearRead(FileReader* f) {
+    SetVariable("=", 0.0);
+    for (; f->Available(); f->skipline()) {
+      char variable[33];
+      variable[0] = 0;
+      f->skipwhite();
+      if (f->Peek() == '#') continue;
+      f->readVariable(variable);
+      if (!strcmp(variable,"end")) return ReadStatus::READ_END;
+      f->skipwhite();
+      if (f->Peek() != '=') continue;
+      f->Read();
+      f->skipwhite();
+      SetVariable(variable, f->readFloatValue());
+    }
+    return ReadStatus::READ_OK;
+  }
+
+  int humStart;
+  int volHum;
+  int volEff;
+  float ProffieOSSwingSpeedThreshold;
+  float ProffieOSSwingVolumeSharpness;
+  float ProffieOSMaxSwingVolume;
+  float ProffieOSSwingOverlap;
+  float ProffieOSSmoothSwingDucking;
+  float ProffieOSSwingLowerThreshold;
+  float ProffieOSSlashAccelerationThreshold;
+  float ProffieOSAnimationFrameRate;
+  float ProffieOSFontImageDuration;
+  float ProffieOSOnImageDuration;
+  float ProffieOSBlastImageDuration;
+  float ProffieOSClashImageDuration;
+  float ProffieOSForceImageDuration;
+  float ProffieOSMinSwingAcceleration;
+  float ProffieOSMaxSwingAcceleration;
+  float ProffieOSSpinDegrees;
+};
+
+// Saves all variables as text, so that two reads can be compared.
+std::string Snapshot(BenchConfig& config) {
+  struct SnapshotOP : public ConfigFile::VariableOP {
+    std::string out;
+    void run(const char* name, ConfigFile::VariableBase* var) override {
+      char tmp[128];
+      sprintf(tmp, "%s=%f\n", name, var->get());
+      out += tmp;
+    }
+  };
+  SnapshotOP op;
+  config.iterateVariables(&op);
+  return op.out;
+}
+
+const char* kFilename = "bench_config.ini";
+
+void WriteConfig() {
+  FILE* f = fopen(kFilename, "wb");
+  fprintf(f, "# Generated by config_benchmark\n");
+  fprintf(f, "humStart=800\nvolHum=12\nvolEff=14\n");
+  fprintf(f, "ProffieOSSwingSpeedThreshold=300\n");
+  fprintf(f, "ProffieOSSwingVolumeSharpness=0.75\n");
+  fprintf(f, "ProffieOSMaxSwingVolume=2.5\n");
+  fprintf(f, "ProffieOSSwingOverlap=0.25\n");
+  fprintf(f, "ProffieOSSmoothSwingDucking=0.1\n");
+  fprintf(f, "ProffieOSAnimationFrameRate=24\n");
+  for (size_t i = 0; i < effects.size(); i++) {
+    fprintf(f, "ProffieOS.SFX.%s.paired=%d\n", effects[i].name.c_str(), (int)(i & 1));
+    fprintf(f, "ProffieOS.SFX.%s.volume=%d\n", effects[i].name.c_str(), (int)(50 + i % 100));
+  }
+  // Set some variables twice, the last one should win.
+  fprintf(f, "volHum=13\n");
+  fprintf(f, "proffieos.sfx.%s.volume=77\n", effects[0].name.c_str());
+  fclose(f);
+}
+
+double TimeReads(BenchConfig& config, int n, bool linear) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; i++) {
+    FileReader f;
+    f.Open(kFilename);
+    if (linear) {
+      config.LinearRead(&f);
+    } else {
+      config.Read(&f);
+    }
+    f.Close();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(end - start).count() / n;
+}
+
+int main(int argc, char** argv) {
+  int reads = 200;
+  int num_effects = 90;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+      reads = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-effects") && i + 1 < argc) {
+      num_effects = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "Usage: %s [-n reads] [-effects N]\n", argv[0]);
+      exit(1);
+    }
+  }
+  for (int i = 0; i < num_effects; i++) {
+    char name[16];
+    sprintf(name, "fx%d", i);
+    effects.push_back(Effect{name, 0.0f, 0});
+  }
+  WriteConfig();
+
+  BenchConfig config;
+  TimeReads(config, 1, true);
+  std::string expected = Snapshot(config);
+  TimeReads(config, 1, false);
+  if (Snapshot(config) != expected) {
+    fprintf(stderr, "Read() and LinearRead() disagree!\n");
+    exit(2);
+  }
+
+  double linear = TimeReads(config, reads, true);
+  double sorted = TimeReads(config, reads, false);
+  printf("{ \"variables\": %d, \"lines\": %d, \"linear_us\": %.1f, \"sorted_us\": %.1f, \"speedup\": %.2f }\n",
+         19 + num_effects * 2, 10 + num_effects * 2, linear, sorted, linear / sorted);
+  LSFS::Remove(kFilename);
+}
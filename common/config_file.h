@@ -1,6 +1,7 @@
 #ifndef COMMON_CONFIG_FILE_H
 #define COMMON_CONFIG_FILE_H
 
+#include <algorithm>
 #include "file_reader.h"
 
 // Reads an config file, looking for variable assignments.
@@ -64,6 +65,57 @@ struct ConfigFile {
     FileReader& f_;
   };
 
+  // Case-insensitive FNV-1a hash of a variable name.
+  static uint32_t HashName(const char* name) {
+    uint32_t h = 2166136261u;
+    for (; *name; name++) h = (h ^ (uint8_t)toLower(*name)) * 16777619u;
+    return h;
+  }
+
+  // Assignments read from a file. Instead of looking for each assignment
+  // in all the variables, they are sorted by hash, and each variable
+  // is looked up with a binary search, in one pass over the variables.
+  struct Assignment {
+    uint32_t hash;
+    uint16_t line;
+    float value;
+    char name[33];
+    bool operator<(const Assignment& other) const {
+      if (hash != other.hash) return hash < other.hash;
+      return line < other.line;
+    }
+  };
+
+  struct AssignOP : public VariableOP {
+    AssignOP(Assignment* assignments, int n, bool set_defaults) :
+      assignments_(assignments), n_(n), set_defaults_(set_defaults) {}
+    void run(const char* name, VariableBase* var) override {
+      if (set_defaults_) var->setDefault();
+      uint32_t hash = HashName(name);
+      Assignment* a = std::lower_bound(
+	assignments_, assignments_ + n_, hash,
+	[](const Assignment& a, uint32_t hash) { return a.hash < hash; });
+      // If a variable is set more than once, the last one wins.
+      Assignment* found = nullptr;
+      for (; a < assignments_ + n_ && a->hash == hash; a++) {
+	if (!strcasecmp(name, a->name)) found = a;
+      }
+      if (found) var->set(found->value);
+    }
+  private:
+    Assignment* assignments_;
+    int n_;
+    bool set_defaults_;
+  };
+
+  // Sets the variables in |assignments|, and if |set_defaults| is true,
+  // resets all other variables to their default values.
+  void SetVariables(Assignment* assignments, int n, bool set_defaults) {
+    std::sort(assignments, assignments + n);
+    AssignOP op(assignments, n, set_defaults);
+    iterateVariables(&op);
+  }
+
   template<class T>
   void DoVariableOp(VariableOP *op, const char* name, T& ref, T def) {
     Variable<T> var(ref, def);
@@ -76,8 +128,11 @@ struct ConfigFile {
     READ_END,
   };
   virtual ReadStatus Read(FileReader* f) {
-    SetVariable("=", 0.0);  // This resets all variables.
-    if (!f || !f->IsOpen()) return ReadStatus::READ_FAIL;
+    if (!f || !f->IsOpen()) {
+      SetVariable("=", 0.0);  // This resets all variables.
+      return ReadStatus::READ_FAIL;
+    }
+    AssignmentBuffer buffer(this);
     for (; f->Available(); f->skipline()) {
       char variable[33];
       variable[0] = 0;
@@ -103,12 +158,58 @@ struct ConfigFile {
       STDOUT.print(" = ");
       STDOUT.println(v);
 #endif
-      SetVariable(variable, v);
+      buffer.Add(variable, v);
     }
     return ReadStatus::READ_OK;
   }
 
 
+  // Collects the assignments in a file, and sets the variables when it
+  // goes out of scope. If we run out of memory, the assignments collected
+  // so far are set right away.
+  class AssignmentBuffer {
+  public:
+    explicit AssignmentBuffer(ConfigFile* config) : config_(config) {}
+    ~AssignmentBuffer() {
+      Flush();
+      free(assignments_);
+    }
+    void Add(const char* name, float value) {
+      if (n_ == size_) {
+	int new_size = size_ ? size_ * 2 : 16;
+	Assignment* tmp = (Assignment*)realloc(assignments_, new_size * sizeof(Assignment));
+	if (tmp) {
+	  assignments_ = tmp;
+	  size_ = new_size;
+	} else {
+	  Flush();
+	  if (!size_) {
+	    config_->SetVariable(name, value);
+	    return;
+	  }
+	}
+      }
+      Assignment& a = assignments_[n_];
+      a.hash = HashName(name);
+      a.line = lines_++;
+      a.value = value;
+      strcpy(a.name, name);
+      n_++;
+    }
+    void Flush() {
+      config_->SetVariables(assignments_, n_, !flushed_);
+      flushed_ = true;
+      n_ = 0;
+    }
+  private:
+    ConfigFile* config_;
+    Assignment* assignments_ = nullptr;
+    int n_ = 0;
+    int size_ = 0;
+    uint16_t lines_ = 0;
+    bool flushed_ = false;
+  };
+
   virtual void SetVariable(const char* variable, float v) {
     if (!strcmp(variable, "=")) {
       SetDefaultOP op;
@@ -3,6 +3,7 @@
 
 #include "preset.h"
 #include "file_reader.h"
+#include "preset_store.h"
 #include "blade_config.h"
 
 class CurrentPreset {
@@ -195,6 +196,52 @@ public:
     return true;
   }
 
+  // Binary record for PresetStore: the variation, followed by font, track,
+  // styles and name as zero-terminated strings. Returns the number of bytes
+  // needed, which may be more than |size|, in which case |record| is not
+  // completely filled in.
+  int ToRecord(uint8_t* record, int size) {
+    int pos = sizeof(variation);
+    if (pos <= size) memcpy(record, &variation, sizeof(variation));
+    const char* strings[] = {
+      font.get(),
+      track.get(),
+#define RECORD_STYLE_STRING(N) current_style##N.get(),
+      ONCEPERBLADE(RECORD_STYLE_STRING)
+      name.get(),
+    };
+    for (const char* str : strings) {
+      if (!str) str = "";
+      int len = strlen(str) + 1;
+      if (pos + len <= size) memcpy(record + pos, str, len);
+      pos += len;
+    }
+    if (pos < size) memset(record + pos, 0, size - pos);
+    return pos;
+  }
+
+  bool FromRecord(const uint8_t* record, int size) {
+    preset_type = PRESET_DISK;
+    memcpy(&variation, record, sizeof(variation));
+    int pos = sizeof(variation);
+    LSPtr<char>* strings[] = {
+      &font,
+      &track,
+#define RECORD_STYLE_PTR(N) &current_style##N,
+      ONCEPERBLADE(RECORD_STYLE_PTR)
+      &name,
+    };
+    for (LSPtr<char>* str : strings) {
+      const char* start = (const char*)record + pos;
+      const char* end = (const char*)memchr(start, 0, size - pos);
+      if (!end) return false;
+      *str = mkstr(start);
+      pos += end - start + 1;
+    }
+    DOVALIDATE(*this);
+    return true;
+  }
+
   void Print() {
     PrintQuotedValue("FONT", font.get());
     PrintQuotedValue("TRACK", track.get());
@@ -248,6 +295,7 @@ public:
   }
 
   bool UpdateINI() {
+    checked_ini_size_ = kNoINISize;
     FileReader f, f2;
     PathHelper ini_fn(GetSaveDir(), "presets.ini");
     if (OpenPresets(&f2, "presets.tmp")) {
@@ -274,6 +322,7 @@ public:
   }
 
   bool CreateINI() {
+    checked_ini_size_ = kNoINISize;
     FileReader f;
     PathHelper ini_fn(GetSaveDir(), "presets.ini");
     LSFS::Remove(ini_fn);
@@ -293,8 +342,142 @@ public:
     return true;
   }
 
+  // Builds presets.bin from |f|, which must be a valid presets.ini.
+  // |ini_hash| is PresetStore::FileChecksum() of |f|.
+  bool ImportINI(FileReader* f, PresetStore* store, uint32_t ini_hash) {
+    uint32_t start = f->Tell();
+    CurrentPreset tmp;
+    int max_size = 0;
+    int count = 0;
+    while (tmp.Read(f)) {
+      max_size = std::max(max_size, tmp.ToRecord(nullptr, 0));
+      count++;
+    }
+    if (count > PresetStore::kMaxPresets) return false;
+    int record_size = (max_size + 511) & ~511;
+    uint8_t* record = (uint8_t*)malloc(record_size);
+    if (!record) return false;
+    bool ok = store->Begin(record_size, ini_hash);
+    f->Seek(start);
+    while (ok && tmp.Read(f)) {
+      tmp.ToRecord(record, record_size);
+      ok = store->Append(record);
+    }
+    free(record);
+    return ok && store->Finish();
+  }
+
+  // Writes presets.bin back out as presets.ini.
+  bool ExportINI(PresetStore* store) {
+    FileReader out;
+    PathHelper tmp_fn(GetSaveDir(), "presets.tmp");
+    LSFS::Remove(tmp_fn);
+    if (!out.Create(tmp_fn)) return false;
+    out.write_key_value("installed", install_time);
+    uint8_t* record = (uint8_t*)malloc(store->record_size());
+    if (!record) return false;
+    CurrentPreset tmp;
+    bool ok = true;
+    for (int i = 0; ok && i < store->count(); i++) {
+      ok = store->Read(i, record) && tmp.FromRecord(record, store->record_size());
+      if (ok) tmp.Write(&out);
+    }
+    free(record);
+    out.Write("end\n");
+    out.Close();
+    return ok && UpdateINI();
+  }
+
+  // Writes presets.ini from presets.bin, so that the text file can
+  // still be read and edited, and records its checksum in presets.bin,
+  // so that it isn't imported again.
+  bool SyncINI(PresetStore* store) {
+    if (!ExportINI(store)) return false;
+    FileReader f;
+    if (!OpenPresets(&f, "presets.ini")) return false;
+    uint32_t ini_size = f.FileSize();
+    uint32_t ini_hash = PresetStore::FileChecksum(&f);
+    f.Close();
+    if (!store->SetIniHash(ini_hash)) return false;
+    checked_ini_size_ = ini_size;
+    return true;
+  }
+
+  // Opens presets.bin. If there is a presets.ini which is different
+  // from the one presets.bin was made from, or if there is no
+  // presets.bin, presets.bin is made from presets.ini.
+  // Checking presets.ini means reading all of it, so it is only done
+  // once, and again if its size changes.
+  bool OpenStore(PresetStore* store) {
+    bool have_store = store->Open();
+    PathHelper ini_fn(GetSaveDir(), "presets.ini");
+    FileReader f;
+    if (!have_store || LSFS::Exists(ini_fn)) {
+      if (!OpenPresets(&f, "presets.ini")) {
+	if (have_store) return true;
+	if (!UpdateINI()) return false;
+	if (!OpenPresets(&f, "presets.ini")) return false;
+      }
+      if (have_store && f.FileSize() == checked_ini_size_) return true;
+      uint32_t ini_hash = PresetStore::FileChecksum(&f);
+      if (!have_store || store->ini_hash() != ini_hash) {
+	if (!ImportINI(&f, store, ini_hash)) return false;
+      }
+      checked_ini_size_ = f.FileSize();
+      return true;
+    }
+    // Made before presets.ini was kept up to date.
+    SyncINI(store);
+    return true;
+  }
+
+  bool LoadFromStore(PresetStore* store, int preset) {
+    int count = store->count();
+    if (!count) return false;
+    if (preset == -1) preset = count - 1;
+    if (preset == count) preset = 0;
+    if (preset < 0 || preset >= count) return false;
+    uint8_t* record = (uint8_t*)malloc(store->record_size());
+    if (!record) return false;
+    bool ok = store->Read(preset, record) && FromRecord(record, store->record_size());
+    free(record);
+    if (ok) preset_num = preset;
+    return ok;
+  }
+
+  // Saves this preset in presets.bin, returns false if the text
+  // files need to be used instead.
+  bool SaveToStore(PresetStore* store, int position) {
+    int record_size = store->record_size();
+    uint8_t* record = (uint8_t*)malloc(record_size);
+    if (!record) return false;
+    bool fits = ToRecord(record, record_size) <= record_size;
+    int from = preset_num >= 0 && preset_num < store->count() ? preset_num : -1;
+    bool saved = fits && store->Update(from, position, record);
+    free(record);
+    if (saved) {
+      preset_num = position;
+      // Keep presets.ini up to date for anything that reads it.
+      SyncINI(store);
+      return true;
+    }
+    // presets.ini still has the presets, save with the text files.
+    if (fits) return false;
+    // Too big for the records in presets.bin, fall back to presets.ini,
+    // presets.bin will be re-created with bigger records when loading.
+    if (!ExportINI(store)) return false;
+    store->Close();
+    PathHelper bin_fn(GetSaveDir(), "presets.bin");
+    LSFS::Remove(bin_fn);
+    return false;
+  }
+
   // preset = -1 means to load the *last* pre
   bool Load(int preset) {
+    {
+      PresetStore store;
+      if (OpenStore(&store)) return LoadFromStore(&store, preset);
+    }
     FileReader f;
     if (!OpenPresets(&f, "presets.ini")) {
       if (!UpdateINI()) return false;
@@ -321,6 +504,14 @@ public:
 
   void SaveAtLocked(int position) {
     DOVALIDATE(*this);
+    {
+      PresetStore store;
+      if (!OpenStore(&store)) {
+	CreateINI();
+	OpenStore(&store);
+      }
+      if (store.IsOpen() && SaveToStore(&store, position)) return;
+    }
     FileReader f, out;
     if (!OpenPresets(&f, "presets.ini")) {
       if (!UpdateINI()) CreateINI();
@@ -375,6 +566,10 @@ public:
 
   void Save() { SaveAt(preset_num); }
 
+  // Size of the presets.ini that was last found to match presets.bin.
+  static const uint32_t kNoINISize = 0xFFFFFFFFU;
+  static uint32_t checked_ini_size_;
+
   void SetPreset(int preset) {
     Clear();
     LOCK_SD(true);
@@ -402,4 +597,6 @@ const char* GetStyle(int blade) {
 
 };
 
+uint32_t CurrentPreset::checked_ini_size_ = CurrentPreset::kNoINISize;
+
 #endif
@@ -126,12 +126,14 @@ public:
   void push(const T& value) {
     push(value, micros());
   }
-  void clear(const T& value) {
-    uint32_t now = micros();
+  void clear(const T& value, uint32_t now) {
     line_.Start(now);
     values_ = 0;
     push(value, now);
   }
+  void clear(const T& value) {
+    clear(value, micros());
+  }
   bool ready() { return line_.samples() == SIZE; }
   T& last() { return data_[entry_].v; }
   uint32_t last_time() { return data_[entry_].t; }
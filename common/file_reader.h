@@ -145,6 +145,19 @@ public:
       type_ = TYPE_SD;
       return true;
     }
+#endif
+    return false;
+  }
+  // Opens an existing file for in-place updates.
+  bool OpenRW(const char* filename) {
+    Close();
+#ifdef ENABLE_SD
+    new (&sd_file_) File;
+    sd_file_ = LSFS::OpenRW(filename);
+    if (sd_file_) {
+      type_ = TYPE_SD;
+      return true;
+    }
 #endif
     return false;
   }
@@ -172,6 +185,27 @@ public:
     type_ = TYPE_MEM;
     mem_file_ = MemFile();
   }
+  // Takes over the file that |other| has open, |other| is left closed.
+  void MoveFrom(FileReader& other) {
+    if (&other == this) return;
+    Close();
+    Destroy();
+    type_ = other.type_;
+    switch (type_) {
+      IF_SD(case TYPE_SD: new (&sd_file_) File(other.sd_file_); break;)
+      IF_SF(case TYPE_SF: new (&sf_file_) SerialFlashFile(other.sf_file_); break;)
+      IF_MEM(case TYPE_MEM: new (&mem_file_) MemFile(other.mem_file_); break;)
+    }
+    other.Destroy();
+    other.type_ = TYPE_MEM;
+    new (&other.mem_file_) MemFile();
+  }
+  void Swap(FileReader& other) {
+    FileReader tmp;
+    tmp.MoveFrom(other);
+    other.MoveFrom(*this);
+    MoveFrom(tmp);
+  }
   int Read(uint8_t* dest, int bytes) {
     RUN_ALL(read(dest, bytes))
     return 0;
@@ -232,13 +266,15 @@ public:
     }
     return true;
   }
+  // Returns how much of a read of |n| bytes to do so that reads start
+  // on SD block boundaries. Once aligned, reads of several whole blocks
+  // are allowed, which lets the card use multi-block transfers.
   int AlignRead(int n) {
 #ifdef ENABLE_SD
     if (type_ == TYPE_SD) {
       uint32_t pos = Tell();
-      uint32_t next_block = (pos + 512u) & ~511u;
-      int bytes_to_end_of_block = next_block - pos;
-      return std::min<int>(n, bytes_to_end_of_block);
+      if (pos & 511u) return std::min<int>(n, 512u - (pos & 511u));
+      if (n > 512) return n & ~511;
     }
 #endif
     return n;
@@ -420,6 +456,15 @@ public:
     write_key_value(key, new_value);
   }
 private:
+  // Runs the destructor without closing the file.
+  void Destroy() {
+    switch (type_) {
+      IF_SD(case TYPE_SD: sd_file_.~File(); break;)
+      IF_SF(case TYPE_SF: sf_file_.~SerialFlashFile(); break;)
+      IF_MEM(case TYPE_MEM: mem_file_.~MemFile(); break;)
+    }
+  }
+
   enum {
 #ifdef ENABLE_SD
     TYPE_SD,
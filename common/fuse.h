@@ -69,21 +69,28 @@ public:
     down_(0.0), last_micros_(0) {
   }
   const char* name() override { return "Fusor"; }
+
+  // Motion drivers which read samples in batches from a FIFO call this
+  // with the time each sample was taken before passing it on, and with
+  // zero when done. Otherwise, samples are assumed to be from right now.
+  void SetSampleTime(uint32_t t) { sample_time_ = t; }
+  uint32_t sample_time() { return sample_time_ ? sample_time_ : micros(); }
+
   void DoMotion(const Vec3& gyro, bool clear) {
     CHECK_NAN(gyro);
     if (clear) {
-      gyro_extrapolator_.clear(gyro);
+      gyro_extrapolator_.clear(gyro, sample_time());
     } else {
-      gyro_extrapolator_.push(gyro);
+      gyro_extrapolator_.push(gyro, sample_time());
     }
   }
   void DoAccel(const Vec3& accel, bool clear) {
     CHECK_NAN(accel);
     if (clear) {
-      accel_extrapolator_.clear(accel);
+      accel_extrapolator_.clear(accel, sample_time());
       down_ = accel;
     } else {
-      accel_extrapolator_.push(accel);
+      accel_extrapolator_.push(accel, sample_time());
     }
   }
 
@@ -327,6 +334,7 @@ private:
   Vec3 down_;
   Vec3 mss_;
   uint32_t last_micros_;
+  volatile uint32_t sample_time_ = 0;
   Vec3 accel_;
   Vec3 gyro_;
   float swing_speed_;
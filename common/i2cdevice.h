@@ -231,7 +231,20 @@ public:
 #define I2C_WRITE_BYTE_ASYNC(reg, data) writeByte(reg, data)
 #endif
 
+// The Wire library reads into a buffer which holds only this many bytes.
+#ifndef I2C_MAX_READ_BYTES
+#define I2C_MAX_READ_BYTES 32
+#endif
+
+// Reads |bytes| from a FIFO register, in pieces that fit in the
+// Wire buffer. Every read of |reg| returns the next bytes in the FIFO.
+#define I2C_READ_FIFO_ASYNC(reg, data, bytes)				\
+  for (fifo_read_pos_ = 0; fifo_read_pos_ < (bytes); fifo_read_pos_ += I2C_MAX_READ_BYTES) \
+    I2C_READ_BYTES_ASYNC(reg, (data) + fifo_read_pos_,			\
+			 std::min<int>((bytes) - fifo_read_pos_, I2C_MAX_READ_BYTES))
+
   uint8_t address_;
+  int fifo_read_pos_ = 0;
 };
 
 void DumpI2CDevice(const char* desc, I2CDevice *device) {
@@ -3,6 +3,18 @@
 
 // Helper class for classses that needs to be called back from the Loop()
 // function. Also provides a Setup() function.
+//
+// By default, Loop() is called every time around the main loop, but a
+// looper can tell the scheduler when it actually has work to do:
+//   SetPeriod(us): call Loop() every |us| microseconds.
+//   SleepMicros(us): don't call Loop() again for |us| microseconds.
+//   Suspend(): don't call Loop() again until Wake() is called.
+//   Wake(): call Loop() on the next pass, even if sleeping.
+//           Safe to call from interrupts, use it for DMA done,
+//           data ready and similar events.
+//   SetBudget(cycles): count calls to Loop() which take longer than this.
+// A periodic looper which runs more than one period late counts as a
+// missed deadline. "top" shows missed deadlines and budget overruns.
 class Looper;
 Looper* loopers = NULL;
 Looper* hf_loopers = NULL;
@@ -45,9 +57,9 @@ public:
   static void DoLoop() {
     ScopedCycleCounter cc(loop_cycles);
     CHECK_LL(Looper, loopers, next_looper_);
+    uint32_t now = micros();
     for (Looper *l = loopers; l; l = l->next_looper_) {
-      ScopedCycleCounter cc2(l->cycles_);
-      l->Loop();
+      if (l->Due(now)) l->Run(now);
     }
     global_loop_counter.Update();
     hf_loop_counter.Update();
@@ -55,11 +67,11 @@ public:
   static void DoHFLoop() {
     ScopedCycleCounter cc(loop_cycles);
     CHECK_LL(Looper, loopers, next_looper_);
+    uint32_t now = micros();
     for (Looper *l = hf_loopers; l; l = l->next_looper_) {
       // TODO: We're currently double-counting these cycles, since
       // DoHfLoop() is likely to be called from inside of DoLoop()
-      ScopedCycleCounter cc2(l->cycles_);
-      l->Loop();
+      if (l->Due(now)) l->Run(now);
     }
     hf_loop_counter.Update();
   }
@@ -73,8 +85,19 @@ public:
       STDOUT.print(l->name());
       STDOUT.print(" loop: ");
       STDOUT.print(l->cycles_ * 100.0f / total_cycles);
-      STDOUT.println("%");
+      STDOUT.print("%");
+      if (l->period_) {
+        STDOUT.print(" missed deadlines: ");
+        STDOUT.print(l->missed_);
+      }
+      if (l->budget_) {
+        STDOUT.print(" over budget: ");
+        STDOUT.print(l->overruns_);
+      }
+      STDOUT.println("");
       l->cycles_ = 0;
+      l->missed_ = 0;
+      l->overruns_ = 0;
     }
     loop_cycles = 0;
   }
@@ -85,13 +108,61 @@ public:
     return cycles;
   }
 
+  void Wake() { wake_ = true; }
+
 protected:
   virtual const char* name() = 0;
   virtual void Loop() = 0;
   virtual void Setup() {}
+
+  void SetPeriod(uint32_t period_us) {
+    period_ = period_us;
+    next_run_ = micros();
+    timer_ = period_us != 0;
+  }
+  void SleepMicros(uint32_t us) {
+    next_run_ = micros() + us;
+    timer_ = true;
+  }
+  void Suspend() { suspended_ = true; }
+  void SetBudget(uint32_t cycles) { budget_ = cycles; }
+
 private:
+  bool Due(uint32_t now) const {
+    if (wake_) return true;
+    if (suspended_) return false;
+    return !timer_ || (int32_t)(now - next_run_) >= 0;
+  }
+  void Run(uint32_t now) {
+    wake_ = false;
+    suspended_ = false;
+    if (!period_) {
+      timer_ = false;
+    } else if ((int32_t)(now - next_run_) >= 0) {
+      next_run_ += period_;
+      if ((int32_t)(now - next_run_) >= 0) {
+        missed_++;
+        next_run_ = now + period_;
+      }
+    }
+    uint64_t start = cycles_;
+    {
+      ScopedCycleCounter cc(cycles_);
+      Loop();
+    }
+    if (budget_ && cycles_ - start > budget_) overruns_++;
+  }
+
   uint64_t cycles_ = 0;
   Looper* next_looper_;
+  uint32_t period_ = 0;
+  uint32_t next_run_ = 0;
+  uint32_t budget_ = 0;
+  uint32_t missed_ = 0;
+  uint32_t overruns_ = 0;
+  bool timer_ = false;
+  bool suspended_ = false;
+  volatile bool wake_ = false;
 };
 
 #endif
@@ -147,6 +147,10 @@ public:
   static File OpenForWrite(const char* path) {
     return fopen(path, "wct");
   }
+  // Opens an existing file for reading and writing without truncating it.
+  static File OpenRW(const char* path) {
+    return fopen(path, "r+");
+  }
   class Iterator {
   public:
     explicit Iterator(const char* dirname) {
@@ -174,7 +178,11 @@ public:
     operator bool() { return !!entry_; }
     // bool isdir() { return f_.isDirectory(); }
     const char* name() { return entry_->d_name; }
-    // size_t size() { return f_.size(); }
+    size_t size() {
+      struct stat s;
+      if (fstatat(dirfd(dir_.get()), entry_->d_name, &s, 0) != 0) return 0;
+      return s.st_size;
+    }
     
   private:
     LinkedPtr<DIR, DoCloseDir> dir_;
@@ -230,6 +238,11 @@ public:
     }
     return f;
   }
+  // Opens an existing file for reading and writing without truncating it.
+  static File OpenRW(const char* path) {
+    if (!SD.exists(path)) return File();
+    return SD.open(path, FILE_WRITE);
+  }
   class Iterator {
   public:
     explicit Iterator(const char* dirname) {
@@ -349,6 +362,11 @@ public:
     }
     return f;
   }
+  // Opens an existing file for reading and writing without truncating it.
+  static File OpenRW(const char* path) {
+    if (!mounted_) return File();
+    return DOSFS.open(path, "r+");
+  }
   class Iterator {
   public:
     explicit Iterator(const char* path) {
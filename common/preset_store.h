@@ -0,0 +1,260 @@
+#ifndef COMMON_PRESET_STORE_H
+#define COMMON_PRESET_STORE_H
+
+#include "file_reader.h"
+#include "lsfs.h"
+
+// Binary preset storage.
+// presets.bin has a 512-byte header followed by fixed-size records,
+// one per preset. The header has an index that maps each preset number
+// to a record. Loading a preset reads one record. Saving a preset writes
+// one record and the header, instead of rewriting the whole file.
+// Every change is first written to presets.jnl, then applied to
+// presets.bin. If the power goes out in the middle of a save, the
+// journal is replayed or thrown away the next time the store is opened.
+// The contents of the records are up to CurrentPreset.
+class PresetStore {
+public:
+  static const int kHeaderSize = 512;
+  static const int kMaxPresets = (kHeaderSize - 48) / 2;
+  static const uint16_t kNoRecord = 0xffff;
+
+  struct Header {
+    char magic[4];
+    uint16_t record_size;
+    // Number of presets.
+    uint16_t count;
+    // Number of records in the file, used or not.
+    uint16_t num_records;
+    uint16_t reserved;
+    // FileChecksum() of the presets.ini that this store was made from.
+    uint32_t ini_hash;
+    char installed[32];
+    // Record number for each preset.
+    uint16_t index[kMaxPresets];
+  };
+  static_assert(sizeof(Header) == kHeaderSize, "preset store header must be one block");
+
+  PresetStore() { memset(&header_, 0, sizeof(header_)); }
+  ~PresetStore() { Close(); }
+
+  bool Open() {
+    Close();
+    Replay();
+    PathHelper fn(GetSaveDir(), "presets.bin");
+    if (!file_.Open(fn)) return false;
+    if (file_.Read((uint8_t*)&header_, kHeaderSize) != kHeaderSize ||
+	!ValidHeader(header_) ||
+	file_.FileSize() < kHeaderSize + (uint32_t)header_.num_records * header_.record_size) {
+      file_.Close();
+      return false;
+    }
+    return true;
+  }
+  void Close() { file_.Close(); }
+  bool IsOpen() { return file_.IsOpen(); }
+
+  int count() const { return header_.count; }
+  int record_size() const { return header_.record_size; }
+  uint32_t ini_hash() const { return header_.ini_hash; }
+
+  // Checksum of the rest of |f|, the position is restored afterwards.
+  static uint32_t FileChecksum(FileReader* f) {
+    uint32_t start = f->Tell();
+    uint32_t sum = 2166136261u;
+    uint8_t buf[512];
+    while (f->Available()) {
+      int n = std::min<int>(f->Available(), sizeof(buf));
+      if (f->Read(buf, n) != n) break;
+      sum = Checksum(sum, buf, n);
+    }
+    f->Seek(start);
+    return sum;
+  }
+
+  bool Read(int preset, uint8_t* record) {
+    if (preset < 0 || preset >= header_.count) return false;
+    file_.Seek(RecordPos(header_.index[preset]));
+    return file_.Read(record, header_.record_size) == header_.record_size;
+  }
+
+  // Creating a new store: Begin(), Append() each preset, then Finish().
+  // The header is written last, so a partial store is never valid.
+  bool Begin(int record_size, uint32_t ini_hash) {
+    Close();
+    memset(&header_, 0, sizeof(header_));
+    header_.record_size = record_size;
+    header_.ini_hash = ini_hash;
+    PathHelper fn(GetSaveDir(), "presets.bin");
+    LSFS::Remove(fn);
+    PathHelper jnl_fn(GetSaveDir(), "presets.jnl");
+    LSFS::Remove(jnl_fn);
+    if (!file_.Create(fn)) return false;
+    return file_.Write((uint8_t*)&header_, kHeaderSize) == kHeaderSize;
+  }
+  bool Append(const uint8_t* record) {
+    if (header_.count == kMaxPresets) return false;
+    if (file_.Write(record, header_.record_size) != header_.record_size) return false;
+    header_.index[header_.count] = header_.num_records++;
+    header_.count++;
+    return true;
+  }
+  bool Finish() {
+    memcpy(header_.magic, "PSB1", 4);
+    strncpy(header_.installed, install_time, sizeof(header_.installed) - 1);
+    file_.Seek(0);
+    bool ok = file_.Write((uint8_t*)&header_, kHeaderSize) == kHeaderSize;
+    file_.Close();
+    return ok && Open();
+  }
+
+  // Moves preset |from| to |to|, and replaces its contents with |record|.
+  // from = -1 adds a new preset, to = -1 deletes the preset.
+  bool Update(int from, int to, const uint8_t* record) {
+    Header h = header_;
+    uint16_t slot = kNoRecord;
+    if (from >= 0 && from < h.count) {
+      slot = h.index[from];
+      memmove(h.index + from, h.index + from + 1, (h.count - from - 1) * sizeof(h.index[0]));
+      h.count--;
+    } else if (to < 0) {
+      return true;
+    }
+    if (to >= 0) {
+      if (h.count == kMaxPresets) return false;
+      if (slot == kNoRecord) slot = FreeRecord(h);
+      to = std::min<int>(to, h.count);
+      memmove(h.index + to + 1, h.index + to, (h.count - to) * sizeof(h.index[0]));
+      h.index[to] = slot;
+      h.count++;
+    } else {
+      slot = kNoRecord;
+      record = nullptr;
+    }
+    Close();
+    if (!WriteJournal(h, slot, record)) return false;
+    if (!Replay()) return false;
+    return Open();
+  }
+
+  // Records the checksum of the presets.ini that matches the store.
+  bool SetIniHash(uint32_t ini_hash) {
+    if (header_.ini_hash == ini_hash) return true;
+    Header h = header_;
+    h.ini_hash = ini_hash;
+    Close();
+    if (!WriteJournal(h, kNoRecord, nullptr)) return false;
+    if (!Replay()) return false;
+    return Open();
+  }
+
+private:
+  static bool ValidHeader(const Header& h) {
+    if (memcmp(h.magic, "PSB1", 4)) return false;
+#ifndef KEEP_SAVEFILES_WHEN_PROGRAMMING
+    if (strncmp(h.installed, install_time, sizeof(h.installed) - 1)) return false;
+#endif
+    if (h.record_size < 16 || h.count > kMaxPresets) return false;
+    for (int i = 0; i < h.count; i++) {
+      if (h.index[i] >= h.num_records) return false;
+    }
+    return true;
+  }
+
+  uint32_t RecordPos(int slot) const {
+    return kHeaderSize + (uint32_t)slot * header_.record_size;
+  }
+
+  // Returns a record which isn't used by any preset.
+  static uint16_t FreeRecord(Header& h) {
+    for (uint16_t slot = 0; slot < h.num_records; slot++) {
+      bool used = false;
+      for (int i = 0; i < h.count; i++) {
+	if (h.index[i] == slot) used = true;
+      }
+      if (!used) return slot;
+    }
+    return h.num_records++;
+  }
+
+  // FNV-1a
+  static uint32_t Checksum(uint32_t sum, const uint8_t* data, int len) {
+    for (int i = 0; i < len; i++) sum = (sum ^ data[i]) * 16777619u;
+    return sum;
+  }
+
+  // Journal: header, record number, record (if any), checksum.
+  bool WriteJournal(const Header& h, uint16_t slot, const uint8_t* record) {
+    PathHelper jnl_fn(GetSaveDir(), "presets.jnl");
+    FileReader f;
+    LSFS::Remove(jnl_fn);
+    if (!f.Create(jnl_fn)) return false;
+    uint32_t sum = 2166136261u;
+    bool ok = f.Write((const uint8_t*)&h, kHeaderSize) == kHeaderSize;
+    sum = Checksum(sum, (const uint8_t*)&h, kHeaderSize);
+    ok = ok && f.Write((const uint8_t*)&slot, sizeof(slot)) == sizeof(slot);
+    sum = Checksum(sum, (const uint8_t*)&slot, sizeof(slot));
+    if (record) {
+      ok = ok && f.Write(record, h.record_size) == h.record_size;
+      sum = Checksum(sum, record, h.record_size);
+    }
+    ok = ok && f.Write((const uint8_t*)&sum, sizeof(sum)) == sizeof(sum);
+    f.Close();
+    return ok;
+  }
+
+  // Applies presets.jnl to presets.bin, if it is complete, then removes it.
+  // Returns false if there was a journal, but it could not be applied.
+  bool Replay() {
+    PathHelper jnl_fn(GetSaveDir(), "presets.jnl");
+    if (!LSFS::Exists(jnl_fn)) return true;
+    FileReader f;
+    if (!f.Open(jnl_fn)) return false;
+    Header h;
+    uint16_t slot;
+    uint32_t sum = 2166136261u;
+    uint32_t stored_sum;
+    uint8_t* record = nullptr;
+    bool complete = false;
+    if (f.Read((uint8_t*)&h, kHeaderSize) == kHeaderSize &&
+	ValidHeader(h) &&
+	f.Read((uint8_t*)&slot, sizeof(slot)) == sizeof(slot)) {
+      sum = Checksum(sum, (const uint8_t*)&h, kHeaderSize);
+      sum = Checksum(sum, (const uint8_t*)&slot, sizeof(slot));
+      complete = true;
+      if (slot != kNoRecord) {
+	record = (uint8_t*)malloc(h.record_size);
+	complete = record && f.Read(record, h.record_size) == h.record_size;
+	if (complete) sum = Checksum(sum, record, h.record_size);
+      }
+      complete = complete &&
+	f.Read((uint8_t*)&stored_sum, sizeof(stored_sum)) == sizeof(stored_sum) &&
+	stored_sum == sum;
+    }
+    f.Close();
+    // An incomplete journal means that presets.bin was never touched.
+    bool ok = true;
+    if (complete) {
+      PathHelper fn(GetSaveDir(), "presets.bin");
+      FileReader out;
+      ok = out.OpenRW(fn);
+      if (ok && record) {
+	out.Seek(kHeaderSize + (uint32_t)slot * h.record_size);
+	ok = out.Write(record, h.record_size) == h.record_size;
+      }
+      if (ok) {
+	out.Seek(0);
+	ok = out.Write((const uint8_t*)&h, kHeaderSize) == kHeaderSize;
+      }
+      out.Close();
+    }
+    if (record) free(record);
+    if (ok) LSFS::Remove(jnl_fn);
+    return ok;
+  }
+
+  Header header_;
+  FileReader file_;
+};
+
+#endif
@@ -51,6 +51,7 @@ public:
 protected:
   void Setup() override {
     last_enabled_ = millis();
+    SetPeriod(10000);
   }
 
   void Loop() override {
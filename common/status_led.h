@@ -13,6 +13,7 @@ public:
   StatusLED() {}
   void Setup() {
     pinMode(chargeDetectPin, INPUT_PULLUP);
+    SetPeriod(5000);
   }
 
   // information:
@@ -36,8 +37,6 @@ public:
 
   void Loop() override {
     uint32_t now_millis = millis();
-    if (now_millis - last_millis_ < 5) return;
-    last_millis_ = now_millis;
 
     bool ignited = SaberBase::IsOn();
     bool usb_on = USBD_Connected();
@@ -130,7 +129,6 @@ private:
   int blinks_ = 0;
   bool repeat_ = false;
   uint32_t last_micros_;
-  uint32_t last_millis_;
   float pos_ = 0;
   bool active_ = false;
   SimplePWMPin<statusLEDPin> pin_;
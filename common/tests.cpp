@@ -36,9 +36,7 @@ int32_t clampi32(int32_t x, int32_t a, int32_t b) {
   if (x > b) return b;
   return x;
 }
-int constexpr toLower(char x) {
-  return (x >= 'A' && x <= 'Z') ? x - 'A' + 'a' : x;
-}
+#include "strfun.h"
 
 class Looper {
 public:
@@ -94,6 +92,9 @@ void PrintQuotedValue(const char *name, const char* str) {
 
 #include "monitoring.h"
 #include "current_preset.h"
+const char* current_directory = nullptr;
+const char* next_current_directory(const char* dir) { return nullptr; }
+#include "config_file.h"
 #include "color.h"
 #include "fuse.h"
 
@@ -177,6 +178,8 @@ void create_test_presets_ini(const char* filename, int presets, bool finish, con
 void RemovePresetINI() {
   LSFS::Remove("presets.ini");
   LSFS::Remove("presets.tmp");
+  LSFS::Remove("presets.bin");
+  LSFS::Remove("presets.jnl");
   CurrentPreset preset;
   CHECK(!preset.Load(0));
 }
@@ -252,6 +255,148 @@ void test_current_preset() {
   CHECK_EQ(preset.preset_num, 4);
 }
 
+// Writes a presets.jnl which reorders the presets in presets.bin.
+void write_test_journal(int a, int b, bool complete) {
+  PresetStore::Header h;
+  FILE* f = fopen("presets.bin", "rb");
+  CHECK(f);
+  CHECK_EQ(fread(&h, sizeof(h), 1, f), 1u);
+  fclose(f);
+  std::swap(h.index[a], h.index[b]);
+  uint16_t slot = PresetStore::kNoRecord;
+  uint32_t sum = 2166136261u;
+  for (size_t i = 0; i < sizeof(h); i++) sum = (sum ^ ((uint8_t*)&h)[i]) * 16777619u;
+  for (size_t i = 0; i < sizeof(slot); i++) sum = (sum ^ ((uint8_t*)&slot)[i]) * 16777619u;
+  f = fopen("presets.jnl", "wb");
+  CHECK(f);
+  fwrite(&h, sizeof(h), 1, f);
+  fwrite(&slot, sizeof(slot), 1, f);
+  if (complete) fwrite(&sum, sizeof(sum), 1, f);
+  fclose(f);
+}
+
+void test_preset_store() {
+  CurrentPreset preset;
+  RemovePresetINI();
+  create_test_presets_ini("presets.ini", 5, true, install_time);
+  CHECK(preset.Load(2));
+  CHECK(LSFS::Exists("presets.bin"));
+  CHECK_EQ(preset.variation, 2u);
+
+  // Update in place.
+  preset.name = mkstr("renamed");
+  preset.variation = 77;
+  preset.Save();
+  CHECK_EQ(PresetOrder(), 1234);
+  // presets.ini is kept up to date.
+  {
+    CurrentPreset text;
+    FileReader f;
+    CHECK(text.OpenPresets(&f, "presets.ini"));
+    CHECK(text.Read(&f));
+    CHECK(text.Read(&f));
+    CHECK(text.Read(&f));
+    CHECK_STREQ(text.name.get(), "renamed");
+  }
+  CHECK(preset.Load(2));
+  CHECK_STREQ(preset.name.get(), "renamed");
+  CHECK_STREQ(preset.current_style3.get(), "style2:3");
+  CHECK_EQ(preset.variation, 77u);
+
+  // Delete and duplicate.
+  CHECK(preset.Load(4));
+  preset.SaveAt(-1);
+  CHECK_EQ(PresetOrder(), 123);
+  CHECK(preset.Load(1));
+  preset.preset_num = -1;
+  preset.SaveAt(0);
+  CHECK_EQ(PresetOrder(), 10123);
+
+  // Incomplete journals are thrown away, complete ones are applied.
+  write_test_journal(0, 1, false);
+  CHECK_EQ(PresetOrder(), 10123);
+  CHECK(!LSFS::Exists("presets.jnl"));
+  write_test_journal(0, 1, true);
+  CHECK_EQ(PresetOrder(), 1123);
+  CHECK(!LSFS::Exists("presets.jnl"));
+
+  // Presets which don't fit in a record go through presets.ini.
+  CHECK(preset.Load(3));
+  std::string long_name(700, 'x');
+  preset.name = mkstr(long_name.c_str());
+  preset.Save();
+  CHECK(preset.Load(3));
+  CHECK_EQ(std::string(preset.name.get()), long_name);
+  CHECK_EQ(PresetOrder(), 1123);
+  CHECK(LSFS::Exists("presets.bin"));
+
+  // A new presets.ini replaces presets.bin.
+  create_test_presets_ini("presets.ini", 3, true, install_time);
+  CHECK_EQ(PresetOrder(), 12);
+
+  // Even if the new presets.ini has the same size.
+  create_test_presets_ini("presets.ini", 3, true, install_time);
+  FILE* f = fopen("presets.ini", "r+");
+  CHECK(f);
+  std::string ini;
+  for (int c = fgetc(f); c != EOF; c = fgetc(f)) ini += (char)c;
+  ini.replace(ini.find("font1"), 5, "fontX");
+  rewind(f);
+  fputs(ini.c_str(), f);
+  fclose(f);
+  // Only checked again after a reboot.
+  CurrentPreset::checked_ini_size_ = CurrentPreset::kNoINISize;
+  CHECK(preset.Load(1));
+  CHECK_STREQ(preset.font.get(), "fontX");
+  RemovePresetINI();
+}
+
+struct TestConfigFile : public ConfigFile {
+  void iterateVariables(VariableOP *op) override {
+    CONFIG_VARIABLE2(Alpha, 1);
+    CONFIG_VARIABLE2(BetaValue, 2.5f);
+    for (int i = 0; i < 20; i++) {
+      char name[32];
+      sprintf(name, "ProffieOS.SFX.fx%d.volume", i);
+      DoVariableOp(op, name, volume[i], 100);
+    }
+  }
+  int Alpha;
+  float BetaValue;
+  int volume[20];
+};
+
+void test_config_file() {
+  FILE* f = fopen("test_config.ini", "wb");
+  CHECK(f);
+  fprintf(f, "# comment\n");
+  fprintf(f, "alpha=5\n");
+  fprintf(f, "BETAVALUE = 3.5\n");
+  fprintf(f, "unknown=9\n");
+  fprintf(f, "ProffieOS.SFX.fx7.volume=55\n");
+  fprintf(f, "alpha=6\n");
+  fprintf(f, "end\n");
+  fprintf(f, "alpha=7\n");
+  fclose(f);
+  TestConfigFile config;
+  CHECK(config.Read("test_config.ini") == ConfigFile::ReadStatus::READ_END);
+  CHECK_EQ(config.Alpha, 6);
+  CHECK_EQ(config.BetaValue, 3.5f);
+  CHECK_EQ(config.volume[7], 55);
+  CHECK_EQ(config.volume[8], 100);
+
+  // Variables which are not in the file go back to their defaults.
+  f = fopen("test_config.ini", "wb");
+  CHECK(f);
+  fprintf(f, "betavalue=1\n");
+  fclose(f);
+  CHECK(config.Read("test_config.ini") == ConfigFile::ReadStatus::READ_OK);
+  CHECK_EQ(config.Alpha, 1);
+  CHECK_EQ(config.BetaValue, 1.0f);
+  CHECK_EQ(config.volume[7], 100);
+  LSFS::Remove("test_config.ini");
+}
+
 void test_byteorder(int byteorder) {
   std::cerr << "Testing " << byteorder <<  std::endl;
   CHECK_EQ(byteorder, Color8::combine_byteorder(Color8::RGB, byteorder));
@@ -600,8 +745,43 @@ void color_tests() {
   STDOUT << tests << " tests.\n";
 }
 
+// Error diffusion should make the average output over many frames
+// match the input, even for values far below one 8-bit step.
+void test_diffuse(uint16_t value) {
+  const int frames = 256;
+  uint8_t residual[3] = { 0, 0, 0 };
+  Color16 c(value, value / 3, value / 7);
+  int sum_r = 0, sum_g = 0, sum_b = 0;
+  for (int frame = 0; frame < frames; frame++) {
+    Color16 d = c.diffuse(residual);
+    // Ordered dithering must not change the diffused color.
+    Color8 out = d.dither(frame, 1);
+    CHECK_EQ(out.r, d.r >> 8);
+    CHECK_EQ(out.g, d.g >> 8);
+    CHECK_EQ(out.b, d.b >> 8);
+    sum_r += out.r;
+    sum_g += out.g;
+    sum_b += out.b;
+  }
+  CHECK_NEAR(sum_r / (float)frames, std::min(c.r / 256.0, 255.0), 1.0 / frames);
+  CHECK_NEAR(sum_g / (float)frames, std::min(c.g / 256.0, 255.0), 1.0 / frames);
+  CHECK_NEAR(sum_b / (float)frames, std::min(c.b / 256.0, 255.0), 1.0 / frames);
+}
+
+void diffuse_tests() {
+  test_diffuse(0);
+  test_diffuse(1);
+  test_diffuse(37);
+  test_diffuse(200);
+  test_diffuse(1000);
+  test_diffuse(32768);
+  test_diffuse(65279);
+  test_diffuse(65535);
+}
+
 int main() {
   color_tests();
+  diffuse_tests();
   fuse_tests();
   test_rotate();
   extras = false;
@@ -609,6 +789,8 @@ int main() {
   fprintf(stderr, "Extra variables enabled....\n");
   extras = true;
   test_current_preset();
+  test_preset_store();
+  test_config_file();
   byteorder_tests();
   extrapolator_test();
 }
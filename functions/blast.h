@@ -32,9 +32,17 @@ template<int FADEOUT_MS = 200,
   BladeEffectType EFFECT = EFFECT_BLAST>
 class BlastF {
 public:
-  void run(BladeBase* blade) {
+  FunctionRunResult run(BladeBase* blade) {
     num_leds_ = blade->num_leds();
     num_blasts_ = blade->GetEffects(&effects_);
+    for (size_t i = 0; i < num_blasts_; i++) {
+      if (effects_[i].type == EFFECT &&
+	  micros() - effects_[i].start_micros < FADEOUT_MS * 1000) {
+	return FunctionRunResult::UNKNOWN;
+      }
+    }
+    // No blast in progress, getInteger() returns zero until the next one.
+    return FunctionRunResult::ZERO_UNTIL_IGNITION;
   }
 
   int getInteger(int led) {
@@ -73,9 +81,16 @@ private:
 template<int FADEOUT_MS = 250, BladeEffectType EFFECT = EFFECT_BLAST>
 class BlastFadeoutF {
 public:
-  void run(BladeBase* blade) {
+  FunctionRunResult run(BladeBase* blade) {
     num_leds_ = blade->num_leds();
     num_blasts_ = blade->GetEffects(&effects_);
+    for (size_t i = 0; i < num_blasts_; i++) {
+      if (effects_[i].type == EFFECT &&
+	  micros() - effects_[i].start_micros < FADEOUT_MS * 1000) {
+	return FunctionRunResult::UNKNOWN;
+      }
+    }
+    return FunctionRunResult::ZERO_UNTIL_IGNITION;
   }
   int getInteger(int led) {
     if (num_blasts_ == 0) return 0;
@@ -106,9 +121,13 @@ private:
 template<BladeEffectType EFFECT=EFFECT_BLAST>
 class OriginalBlastF {
 public:
-  void run(BladeBase* blade) {
+  FunctionRunResult run(BladeBase* blade) {
     num_leds_ = blade->num_leds();
     num_blasts_ = blade->GetEffects(&effects_);
+    for (size_t i = 0; i < num_blasts_; i++) {
+      if (effects_[i].type == EFFECT) return FunctionRunResult::UNKNOWN;
+    }
+    return FunctionRunResult::ZERO_UNTIL_IGNITION;
   }
   int getInteger(int led) {
     if (num_blasts_ == 0) return 0;
@@ -40,6 +40,20 @@ public:
     int m = dist & 0x3f;
     return bump_shape[p] * (128 - m) + bump_shape[p+1] * m;
   }
+  void getIntegers(int begin, int end, int* out) {
+    int mult = mult_;
+    int x = begin * mult - location_;
+    for (int led = begin; led < end; led++, x += mult) {
+      uint32_t dist = abs(x);
+      uint32_t p = dist >> 7;
+      if (p >= NELEM(bump_shape) - 1) {
+	*(out++) = 0;
+      } else {
+	int m = dist & 0x3f;
+	*(out++) = bump_shape[p] * (128 - m) + bump_shape[p+1] * m;
+      }
+    }
+  }
 private:
   PONUA SVFWrapper<BUMP_POSITION> pos_;
   PONUA SVFWrapper<BUMP_WIDTH_FRACTION> fraction_;
@@ -18,8 +18,11 @@ template<class POSITION, class FRACTION>
 class CircularSectionF {
 public:
   FunctionRunResult run(BladeBase* base) {
-    pos_.run(base);
+    FunctionRunResult pos_ret = RunFunction(&pos_, base);
     FunctionRunResult ret = RunFunction(&fraction_, base);
+    // A moving section of non-zero size is not unchanged.
+    if (ret == FunctionRunResult::UNCHANGED && pos_ret == FunctionRunResult::UNKNOWN)
+      ret = FunctionRunResult::UNKNOWN;
     
     num_leds_ = base->num_leds();;
     int fraction = fraction_.calculate(base);
@@ -59,6 +59,7 @@ public:
     }
     ret_ = extension * 32768.0;
     if (!blade->is_on() && ret_ == 0) return FunctionRunResult::ZERO_UNTIL_IGNITION;
+    if (blade->is_on() && ret_ == 32768) return FunctionRunResult::UNCHANGED;
     return FunctionRunResult::UNKNOWN;
   }
   int getInteger(int led) { return ret_; }
@@ -82,9 +83,11 @@ public:
       switch (ret) {
 	case FunctionRunResult::ZERO_UNTIL_IGNITION: return FunctionRunResult::ONE_UNTIL_IGNITION;
 	case FunctionRunResult::ONE_UNTIL_IGNITION: return FunctionRunResult::ZERO_UNTIL_IGNITION;
+	case FunctionRunResult::UNCHANGED:
 	case FunctionRunResult::UNKNOWN: break;
       }
     }
+    if (ret != FunctionRunResult::UNKNOWN) return FunctionRunResult::UNCHANGED;
     return FunctionRunResult::UNKNOWN;
   }
   int getInteger(int led) {
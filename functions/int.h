@@ -15,11 +15,14 @@ public:
     switch (N) {
       case 0: return FunctionRunResult::ZERO_UNTIL_IGNITION;
       case 32768: return FunctionRunResult::ONE_UNTIL_IGNITION;
-      default: return FunctionRunResult::UNKNOWN;
+      default: return FunctionRunResult::UNCHANGED;
     }
   }
   int calculate(BladeBase* blade) { return N; }
   int getInteger(int led) { return N; }
+  void getIntegers(int begin, int end, int* out) {
+    for (int i = begin; i < end; i++) *(out++) = N;
+  }
 };
 
 // Optimized specialization
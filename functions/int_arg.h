@@ -10,7 +10,7 @@ public:
     switch (value_) {
       case 0: return FunctionRunResult::ZERO_UNTIL_IGNITION;
       case 32768: return FunctionRunResult::ONE_UNTIL_IGNITION;
-      default: return FunctionRunResult::UNKNOWN;
+      default: return FunctionRunResult::UNCHANGED;
     }
   }
   int getInteger(int led) { return value_; }
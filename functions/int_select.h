@@ -20,12 +20,18 @@ public:
     f = f % sizeof...(N);
     const static int values[] = { N ... };
     value_ = values[f];
-    if (frr != FunctionRunResult::UNKNOWN) {
-      switch (value_) {
-        case 0: return FunctionRunResult::ZERO_UNTIL_IGNITION;
-        case 32768: return FunctionRunResult::ONE_UNTIL_IGNITION;
-        default: break;
-      }
+    switch (frr) {
+      case FunctionRunResult::ZERO_UNTIL_IGNITION:
+      case FunctionRunResult::ONE_UNTIL_IGNITION:
+        switch (value_) {
+          case 0: return FunctionRunResult::ZERO_UNTIL_IGNITION;
+          case 32768: return FunctionRunResult::ONE_UNTIL_IGNITION;
+          default: return FunctionRunResult::UNCHANGED;
+        }
+      case FunctionRunResult::UNCHANGED:
+        return FunctionRunResult::UNCHANGED;
+      case FunctionRunResult::UNKNOWN:
+        break;
     }
     return FunctionRunResult::UNKNOWN;
   }
@@ -14,8 +14,11 @@ template<class POSITION, class FRACTION>
 class LinearSectionF {
 public:
   FunctionRunResult run(BladeBase* base) {
-    pos_.run(base);
+    FunctionRunResult pos_ret = RunFunction(&pos_, base);
     FunctionRunResult ret = RunFunction(&fraction_, base);
+    // A moving section of non-zero size is not unchanged.
+    if (ret == FunctionRunResult::UNCHANGED && pos_ret == FunctionRunResult::UNKNOWN)
+      ret = FunctionRunResult::UNKNOWN;
     int num_leds = base->num_leds();
     int fraction = fraction_.calculate(base);
     int pos = pos_.calculate(base);
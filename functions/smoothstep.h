@@ -33,6 +33,20 @@ public:
     if (x > 32768) return 32768;
     return (((x * x) >> 14) * ((3<<14) - x)) >> 15;
   }
+
+  void getIntegers(int begin, int end, int* out) {
+    int mult = mult_;
+    int x = begin * mult - location_;
+    for (int led = begin; led < end; led++, x += mult) {
+      if (x < 0) {
+	*(out++) = 0;
+      } else if (x > 32768) {
+	*(out++) = 32768;
+      } else {
+	*(out++) = (((x * x) >> 14) * ((3<<14) - x)) >> 15;
+      }
+    }
+  }
   
   PONUA SVFWrapper<POS> pos_;
   PONUA SVFWrapper<WIDTH> width_;
@@ -12,6 +12,9 @@
 class SingleValueBase {
 public:
   int getInteger(int led) { return value_; }
+  void getIntegers(int begin, int end, int* out) {
+    for (int i = begin; i < end; i++) *(out++) = value_;
+  }
   int value_;
 };
 
@@ -95,6 +95,17 @@ public:
     CTRL_SPIAux = 0x70
   };
 
+  // Samples are queued in the chip's FIFO, and read in batches.
+  // The data ready interrupt fires when kFifoThreshold samples are queued.
+  // Each sample waits in the FIFO for up to kFifoThreshold * kSampleMicros,
+  // so this is kept low to keep clashes responsive. (1.2ms)
+  static const int kFifoThreshold = 2;
+  static const int kMaxSamples = 16;
+  // One sample is gyro x, y, z followed by accel x, y, z.
+  static const int kSampleWords = 6;
+  // 1.66kHz
+  static const uint32_t kSampleMicros = 602;
+
   LSM6DS3H() : I2CDevice(106), Looper(
 #ifndef PROFFIEBOARD
     HFLINK
@@ -129,7 +140,13 @@ public:
       I2C_WRITE_BYTE_ASYNC(CTRL8_XL, 0x00);
       I2C_WRITE_BYTE_ASYNC(CTRL9_XL, 0x38);  // accel xyz enable
       I2C_WRITE_BYTE_ASYNC(CTRL10_C, 0x38);  // gyro xyz enable
-      I2C_WRITE_BYTE_ASYNC(INT1_CTRL, 0x3);  // Activate INT on data ready
+      I2C_WRITE_BYTE_ASYNC(FIFO_CONTROL5, 0x00);  // bypass mode, empties the FIFO
+      I2C_WRITE_BYTE_ASYNC(FIFO_CONTROL1, kFifoThreshold * kSampleWords);
+      I2C_WRITE_BYTE_ASYNC(FIFO_CONTROL2, 0x00);
+      I2C_WRITE_BYTE_ASYNC(FIFO_CONTROL3, 0x09);  // gyro and accel, no decimation
+      I2C_WRITE_BYTE_ASYNC(FIFO_CONTROL4, 0x00);
+      I2C_WRITE_BYTE_ASYNC(FIFO_CONTROL5, 0x46);  // 1.66kHz, continuous mode
+      I2C_WRITE_BYTE_ASYNC(INT1_CTRL, 0x8);  // Activate INT on FIFO threshold
       pinMode(motionSensorInterruptPin, INPUT);
       I2C_READ_BYTES_ASYNC(WHO_AM_I, databuffer, 1);
       if (databuffer[0] == 105 || databuffer[0] == 106) {
@@ -170,20 +187,12 @@ public:
 	  last_event_ = millis();
 	}
         while (!I2CLock((last_event_ + I2C_TIMEOUT_MILLIS * 2 - millis()) >> 31)) YIELD();
-	
-	I2C_READ_BYTES_ASYNC(OUTX_L_G, databuffer, 12);
-	// accel data available
-	prop.DoAccel(
-	  MotionUtil::FromData(databuffer + 6, 16.0 / 32768.0,   // 16 g range
-			       Vec3::BYTEORDER_LSB, Vec3::ORIENTATION),
-	  first_accel_);
-	first_accel_ = false;
-	// gyroscope data available
-	prop.DoMotion(
-	  MotionUtil::FromData(databuffer, 2000.0 / 32768.0,  // 2000 dps
-			       Vec3::BYTEORDER_LSB, Vec3::ORIENTATION),
-	  first_motion_);
-	first_motion_ = false;
+
+	I2C_READ_BYTES_ASYNC(FIFO_STATUS1, fifo_status_, 4);
+	if (FifoWords()) {
+	  I2C_READ_FIFO_ASYNC(FIFO_DATA_OUT_L, databuffer, FifoWords() * 2);
+	  DeliverSamples(micros());
+	}
 
         I2CUnlock();
       }
@@ -194,6 +203,7 @@ public:
       while (!I2CLock()) YIELD();
       I2C_WRITE_BYTE_ASYNC(CTRL2_G, 0x0);  // accel disable
       I2C_WRITE_BYTE_ASYNC(CTRL1_XL, 0x0);  // gyro disable
+      I2C_WRITE_BYTE_ASYNC(FIFO_CONTROL5, 0x00);  // FIFO disable
       I2CUnlock();
       
       while (!SaberBase::MotionRequested()) YIELD();
@@ -233,28 +243,35 @@ public:
     I2CLockAndRun();
   }
 
-  void RunLocked() override {
-    ScopedCycleCounter cc(motion_interrupt_cycles);
-    TRACE(MOTION, "RunLocked");
-    // All chunks are full
-    if (!digitalRead(motionSensorInterruptPin)) {
-      TRACE(MOTION, "nothing pending2");
-      goto fail;
-    }
+  // Reads the FIFO status, then all the queued samples (up to kMaxSamples)
+  // in one transfer, then delivers them, all from interrupts.
+  bool StartTransfer(uint8_t reg, uint8_t* data, int bytes) {
     if (!stm32l4_i2c_notify(Wire._i2c, &LSM6DS3H::DataReceived, this, (I2C_EVENT_ADDRESS_NACK | I2C_EVENT_DATA_NACK | I2C_EVENT_ARBITRATION_LOST | I2C_EVENT_BUS_ERROR | I2C_EVENT_OVERRUN | I2C_EVENT_RECEIVE_DONE | I2C_EVENT_TRANSMIT_DONE | I2C_EVENT_TRANSFER_DONE | I2C_EVENT_TRANSMIT_ERROR))) {
       TRACE(MOTION, "notify fail");
-      goto fail;
+      return false;
     }
-
-    Wire._tx_data[0] = OUTX_L_G;
+    Wire._tx_data[0] = reg;
     if (!stm32l4_i2c_transfer(Wire._i2c, address_,
 			      Wire._tx_data, 1,
-			      databuffer, 12,
+			      data, bytes,
 			      0)) {
       TRACE(MOTION, "transfer fail");
-      goto fail;
+      return false;
     }
     TRACE(MOTION, "transferring...");
+    return true;
+  }
+
+  void RunLocked() override {
+    ScopedCycleCounter cc(motion_interrupt_cycles);
+    TRACE(MOTION, "RunLocked");
+    // All chunks are full
+    if (!digitalRead(motionSensorInterruptPin)) {
+      TRACE(MOTION, "nothing pending2");
+      goto fail;
+    }
+    reading_data_ = false;
+    if (!StartTransfer(FIFO_STATUS1, fifo_status_, 4)) goto fail;
     return;
   fail:
     I2CUnlock();
@@ -267,24 +284,72 @@ public:
   void DataReceived2() {
     TRACE(MOTION, "Transfer done");
     stm32l4_i2c_notify(Wire._i2c, nullptr, 0, 0);
+    if (!reading_data_) {
+      int words = FifoWords();
+      if (words) {
+	reading_data_ = true;
+	read_micros_ = micros();
+	if (StartTransfer(FIFO_DATA_OUT_L, databuffer, words * 2)) return;
+	reading_data_ = false;
+      }
+      I2CUnlock();
+      last_event_ = millis();
+      return;
+    }
     I2CUnlock();
-    // accel data available
-    prop.DoAccel(MotionUtil::FromData(databuffer + 6, 16.0 / 32768.0,   // 16 g range
-				      Vec3::BYTEORDER_LSB, Vec3::ORIENTATION),
-		 first_accel_);
-    
-    first_accel_ = false;
-    // gyroscope data available
-    prop.DoMotion(MotionUtil::FromData(databuffer, 2000.0 / 32768.0,  // 2000 dps
-				       Vec3::BYTEORDER_LSB, Vec3::ORIENTATION),
-		  first_motion_);
-    first_motion_ = false;
+    DeliverSamples(read_micros_);
     last_event_ = millis();
     Poll();
   }
 #endif // PROFFIEBOARD
 
-  uint8_t databuffer[12];
+  // If the FIFO is in the middle of a sample, the first few words
+  // are dropped to get back in step.
+  int FifoSkip() {
+    int pattern = fifo_status_[2] | ((fifo_status_[3] & 0x3) << 8);
+    return pattern ? kSampleWords - pattern : 0;
+  }
+  int FifoSamples() {
+    int words = fifo_status_[0] | ((fifo_status_[1] & 0xf) << 8);
+    words -= FifoSkip();
+    if (words < kSampleWords) return 0;
+    return std::min<int>(words / kSampleWords, kMaxSamples);
+  }
+  // Number of words to read from the FIFO.
+  int FifoWords() {
+    int samples = FifoSamples();
+    if (!samples) return 0;
+    return FifoSkip() + samples * kSampleWords;
+  }
+
+  // Passes the samples read from the FIFO to the prop, oldest first.
+  // |now| is when the last sample was read.
+  void DeliverSamples(uint32_t now) {
+    int samples = FifoSamples();
+    const uint8_t* data = databuffer + FifoSkip() * 2;
+    for (int i = 0; i < samples; i++, data += kSampleWords * 2) {
+      fusor.SetSampleTime(now - (samples - 1 - i) * kSampleMicros);
+      // accel data available
+      prop.DoAccel(MotionUtil::FromData(data + 6, 16.0 / 32768.0,   // 16 g range
+					Vec3::BYTEORDER_LSB, Vec3::ORIENTATION),
+		   first_accel_);
+      first_accel_ = false;
+      // gyroscope data available
+      prop.DoMotion(MotionUtil::FromData(data, 2000.0 / 32768.0,  // 2000 dps
+					 Vec3::BYTEORDER_LSB, Vec3::ORIENTATION),
+		    first_motion_);
+      first_motion_ = false;
+    }
+    fusor.SetSampleTime(0);
+  }
+
+  uint8_t fifo_status_[4];
+  uint8_t databuffer[(kMaxSamples + 1) * kSampleWords * 2];
+  // On Proffieboards, the FIFO is read into databuffer in a single
+  // transfer, and the I2C controller counts at most 255 bytes.
+  static_assert(sizeof(databuffer) <= 255, "FIFO read too long for one transfer");
+  volatile bool reading_data_ = false;
+  uint32_t read_micros_;
   volatile uint32_t last_event_;
   bool first_motion_;
   bool first_accel_;
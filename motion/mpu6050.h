@@ -101,6 +101,18 @@ public:
   MPU6050() : I2CDevice(0x68) {}
 
 #ifdef ASYNC_READ_MOTION // use Wire.h and ASYNC to read MPU6050
+  // Samples are queued in the chip's FIFO, and read in batches
+  // of up to kMaxSamples, about every kFifoThreshold samples.
+  // Samples wait in the FIFO for up to kFifoThreshold * kSampleMicros,
+  // so the threshold is kept low to keep clashes responsive. (2ms)
+  static const int kFifoThreshold = 2;
+  static const int kMaxSamples = 16;
+  // One sample is accel x, y, z followed by gyro x, y, z.
+  static const int kSampleBytes = 12;
+  // 1kHz
+  static const uint32_t kSampleMicros = 1000;
+  static const int kFifoSize = 1024;
+
   void Loop() override {
     STATE_MACHINE_BEGIN();
 
@@ -122,6 +134,9 @@ public:
       I2C_WRITE_BYTE_ASYNC(INT_PIN_CFG, 0x30);  // interrupt on data available, 
                                                 // cleared on any read
       I2C_WRITE_BYTE_ASYNC(INT_ENABLE, 1);      // enable data ready interrupt
+      I2C_WRITE_BYTE_ASYNC(USER_CTRL, 0x04);    // reset FIFO
+      I2C_WRITE_BYTE_ASYNC(FIFO_EN, 0x78);      // gyro and accel go to the FIFO
+      I2C_WRITE_BYTE_ASYNC(USER_CTRL, 0x40);    // enable FIFO
       pinMode(motionSensorInterruptPin, INPUT);
       I2C_READ_BYTES_ASYNC(WHO_AM_I, databuffer, 1);
       if (databuffer[0] == 0x68) {
@@ -147,31 +162,49 @@ public:
         }
         while (!I2CLock()) YIELD();
 
-        // Do the accel data first to make clashes as fast as possible.
-        // accel data available
-        I2C_READ_BYTES_ASYNC(ACCEL_XOUT_H, databuffer, 14);
-        prop.DoAccel(
-              MotionUtil::FromData(databuffer, 4.0 / 32768.0,   // 4g range
-              Vec3::BYTEORDER_MSB, Vec3::ORIENTATION),
-              false);
-        first_accel_ = false;
+        I2C_READ_BYTES_ASYNC(FIFO_COUNTH, databuffer, 2);
+        fifo_count_ = (databuffer[0] << 8) | databuffer[1];
+        if (fifo_count_ >= kFifoSize - kSampleBytes || fifo_count_ % kSampleBytes) {
+          // Overflow, start over.
+          I2C_WRITE_BYTE_ASYNC(USER_CTRL, 0x44);  // reset and enable FIFO
+          fifo_count_ = 0;
+        }
+        samples_ = std::min<int>(fifo_count_ / kSampleBytes, kMaxSamples);
+        if (samples_) {
+          I2C_READ_FIFO_ASYNC(FIFO_R_W, databuffer, samples_ * kSampleBytes);
+          now_ = micros();
+          for (int i = 0; i < samples_; i++) {
+            const uint8_t* data = databuffer + i * kSampleBytes;
+            fusor.SetSampleTime(now_ - (samples_ - 1 - i) * kSampleMicros);
+            // Do the accel data first to make clashes as fast as possible.
+            // accel data available
+            prop.DoAccel(
+                  MotionUtil::FromData(data, 4.0 / 32768.0,   // 4g range
+                  Vec3::BYTEORDER_MSB, Vec3::ORIENTATION),
+                  false);
+            first_accel_ = false;
 
-        // gyroscope data available
-        prop.DoMotion(
-              MotionUtil::FromData(databuffer+8, 2000.0 / 32768.0,  // 2000 dps
-              Vec3::BYTEORDER_MSB, Vec3::ORIENTATION),
-              false);
-        first_motion_ = false;
+            // gyroscope data available
+            prop.DoMotion(
+                  MotionUtil::FromData(data + 6, 2000.0 / 32768.0,  // 2000 dps
+                  Vec3::BYTEORDER_MSB, Vec3::ORIENTATION),
+                  false);
+            first_motion_ = false;
+          }
+          fusor.SetSampleTime(0);
+        }
 
-        // Temp data available
-        // TODO: Temp Shutdown
-        int16_t temp_data = (databuffer[6] << 8) + databuffer[7];
-        float temp = temp_data / 340.0 + 36.53;
         if (monitor.ShouldPrint(Monitoring::MonitorTemp)) {
+          I2C_READ_BYTES_ASYNC(TEMP_OUT_H, databuffer, 2);
+          // TODO: Temp Shutdown
+          int16_t temp_data = (databuffer[0] << 8) + databuffer[1];
+          float temp = temp_data / 340.0 + 36.53;
           STDOUT.print("TEMP: ");
           STDOUT.println(temp);
         }
         I2CUnlock(); 
+        // Come back when the next batch is ready.
+        if (samples_ < kMaxSamples) SleepMicros(kFifoThreshold * kSampleMicros);
       } // while(true)
           
       STDOUT.println("Motion disable.");
@@ -194,7 +227,10 @@ public:
     STATE_MACHINE_END();
   }
 
-  uint8_t databuffer[14];
+  uint8_t databuffer[kMaxSamples * kSampleBytes];
+  int fifo_count_;
+  int samples_;
+  uint32_t now_;
   int status_reg;
   uint32_t last_temp_;
   uint32_t last_event_;
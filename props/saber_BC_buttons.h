@@ -323,15 +323,15 @@ Turn off blade        - Hold POW and wait until blade is off,
 #endif
 
 EFFECT(dim);        // for EFFECT_POWERSAVE
-EFFECT(battery);    // for EFFECT_BATTERY_LEVEL
+EFFECT_PRIORITY(battery, MENU);    // for EFFECT_BATTERY_LEVEL
 EFFECT(bmbegin);    // for Begin Battle Mode
 EFFECT(bmend);      // for End Battle Mode
-EFFECT(vmbegin);    // for Begin Volume Menu
-EFFECT(vmend);      // for End Volume Menu
-EFFECT(volup);      // for increse volume
-EFFECT(voldown);    // for decrease volume
-EFFECT(volmin);     // for minimum volume reached
-EFFECT(volmax);     // for maximum volume reached
+EFFECT_PRIORITY(vmbegin, MENU);    // for Begin Volume Menu
+EFFECT_PRIORITY(vmend, MENU);      // for End Volume Menu
+EFFECT_PRIORITY(volup, MENU);      // for increse volume
+EFFECT_PRIORITY(voldown, MENU);    // for decrease volume
+EFFECT_PRIORITY(volmin, MENU);     // for minimum volume reached
+EFFECT_PRIORITY(volmax, MENU);     // for maximum volume reached
 EFFECT(faston);     // for EFFECT_FAST_ON
                     // *note* faston.wav does not replace out.wav.
                     // they play layered and concurrently.
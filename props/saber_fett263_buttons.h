@@ -704,18 +704,18 @@ individual tastes.
 #define PROP_TYPE SaberFett263Buttons
 
 EFFECT(dim); // for EFFECT_POWERSAVE
-EFFECT(battery); // for EFFECT_BATTERY_LEVEL
+EFFECT_PRIORITY(battery, MENU); // for EFFECT_BATTERY_LEVEL
 EFFECT(bmbegin); // for Begin Battle Mode
 EFFECT(bmend); // for End Battle Mode
-EFFECT(vmbegin); // for Begin Volume Menu
-EFFECT(vmend); // for End Volume Menu
+EFFECT_PRIORITY(vmbegin, MENU); // for Begin Volume Menu
+EFFECT_PRIORITY(vmend, MENU); // for End Volume Menu
 EFFECT(faston); // for EFFECT_FAST_ON
 EFFECT(blstbgn); // for Begin Multi-Blast
 EFFECT(blstend); // for End Multi-Blast
 EFFECT(push); // for Force Push gesture in Battle Mode
 EFFECT(quote); // quote on force effect
 #ifdef FETT263_EDIT_MODE_MENU
-EFFECT(medit); // Edit Mode
+EFFECT_PRIORITY(medit, MENU); // Edit Mode
 #endif
 
 #include "../sound/sound_library.h"
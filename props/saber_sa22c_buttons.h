@@ -181,15 +181,15 @@
 #define FORCE_PUSH_CONDITION battle_mode_
 
 EFFECT(dim);      // for EFFECT_POWERSAVE
-EFFECT(battery);  // for EFFECT_BATTERY_LEVEL
+EFFECT_PRIORITY(battery, MENU);  // for EFFECT_BATTERY_LEVEL
 EFFECT(bmbegin);  // for Begin Battle Mode
 EFFECT(bmend);    // for End Battle Mode
-EFFECT(vmbegin);  // for Begin Volume Menu
-EFFECT(vmend);    // for End Volume Menu
-EFFECT(volup);    // for increse volume
-EFFECT(voldown);  // for decrease volume
-EFFECT(volmin);   // for minimum volume reached
-EFFECT(volmax);   // for maximum volume reached
+EFFECT_PRIORITY(vmbegin, MENU);  // for Begin Volume Menu
+EFFECT_PRIORITY(vmend, MENU);    // for End Volume Menu
+EFFECT_PRIORITY(volup, MENU);    // for increse volume
+EFFECT_PRIORITY(voldown, MENU);  // for decrease volume
+EFFECT_PRIORITY(volmin, MENU);   // for minimum volume reached
+EFFECT_PRIORITY(volmax, MENU);   // for maximum volume reached
 EFFECT(faston);   // for EFFECT_FAST_ON
 EFFECT(blstbgn);  // for Begin Multi-Blast
 EFFECT(blstend);  // for End Multi-Blast
@@ -25,6 +25,7 @@ public:
     for (AudioStreamWork** d = &data_streams; *d; d = &(*d)->next_) {
       if (*d == this) {
         *d = next_;
+        return;
       }
     }
   }
@@ -35,6 +36,7 @@ public:
     if (!fill_buffers_pending_) {
       fill_buffers_pending_ = true;
       enqueue = true;
+      scheduled_micros_ = micros();
     }
     interrupts();
     if (enqueue) {
@@ -68,11 +70,52 @@ public:
 	return true;
     return false;
   }
+
+  // Called from the audio interrupt when a stream ran dry before eof.
+  static void CountUnderflow() { stats_.underflows++; }
+  // Called from the audio interrupt with the number of samples a
+  // stream has left after a read.
+  static void RecordSlack(uint32_t samples) {
+    stats_.min_slack = std::min(stats_.min_slack, samples);
+  }
+
+  static void DumpStats() {
+    STDOUT << "Stream fills: " << stats_.fills
+           << " max latency: " << stats_.max_latency_micros << "us"
+           << " min slack: " << stats_.min_slack << " samples"
+           << " underflows: " << stats_.underflows
+           << "\n";
+  }
+  static void ResetStats() {
+    stats_ = Stats();
+  }
+
+  struct Stats {
+    // Number of FillBuffer() calls.
+    uint32_t fills = 0;
+    // Longest time between scheduleFillBuffer() and ProcessAudioStreams().
+    uint32_t max_latency_micros = 0;
+    // Fewest samples any playing audio stream had left after being
+    // read from the audio interrupt.
+    uint32_t min_slack = kLowPriority;
+    // Reads from the audio interrupt that came up short.
+    uint32_t underflows = 0;
+  };
+  static const Stats& stats() { return stats_; }
+
+  // Deadlines at or above this are not real deadlines, just an
+  // ordering between streams that are not time-critical.
+  static const uint32_t kLowPriority = 0x10000;
+
 protected:
   virtual bool FillBuffer() = 0;
   virtual bool IsActive() { return false; }
   virtual void CloseFiles() = 0;
+  // Non-zero if FillBuffer() has work to do.
   virtual size_t space_available() const = 0;
+  // Number of samples (at AUDIO_RATE) until this stream runs dry.
+  // The stream with the lowest deadline is filled first.
+  virtual uint32_t deadline() const { return kLowPriority; }
 
 private:
   static void ProcessAudioStreams() {
@@ -81,36 +124,47 @@ private:
       fill_buffers_pending_ = false;
       return;
     }
-#if 1
-    // Yes, it's a selection sort, luckily there's not a lot of
-    // AudioStreamWork instances.
+    uint32_t latency = micros() - scheduled_micros_;
+    stats_.max_latency_micros = std::max(stats_.max_latency_micros, latency);
+
+    // Earliest deadline first. Once a stream has been filled, it
+    // usually has the latest deadline, so streams take turns, and each
+    // turn reads as much as the stream has room for. Streams that have
+    // nothing more to do are left alone until the next time we're called.
+    // There are not a lot of AudioStreamWork instances, so a linear
+    // search for the earliest deadline is fine.
+    for (AudioStreamWork *d = data_streams; d; d=d->next_)
+      d->stalled_ = false;
     for (int i = 0; i < 50; i++) {
-      size_t max_space = 0;
-      for (AudioStreamWork *d = data_streams; d; d=d->next_)
-        max_space = std::max(max_space, d->space_available());
-      if (max_space == 0) break;
+      AudioStreamWork* next = nullptr;
+      uint32_t next_deadline = 0xffffffff;
       for (AudioStreamWork *d = data_streams; d; d=d->next_) {
-        if (d->space_available() >= max_space)
-          d->FillBuffer();
+        if (d->stalled_ || !d->space_available()) continue;
+        uint32_t deadline = d->deadline();
+        if (deadline < next_deadline) {
+          next = d;
+          next_deadline = deadline;
+        }
       }
+      if (!next) break;
+      stats_.fills++;
+      if (!next->FillBuffer()) next->stalled_ = true;
     }
-#else
-    for (int i = 0; i < 10; i++) {
-      for (AudioStreamWork *d = data_streams; d; d=d->next_) {
-        d->FillBuffer();
-      }
-    }
-#endif
     fill_buffers_pending_ = false;
   }
 
   static volatile bool sd_locked;
   static volatile bool fill_buffers_pending_;
+  static uint32_t scheduled_micros_;
+  static Stats stats_;
   AudioStreamWork* next_;
+  bool stalled_ = false;
 };
 
 volatile bool AudioStreamWork::sd_locked = false;
 volatile bool AudioStreamWork::fill_buffers_pending_ = false;
+uint32_t AudioStreamWork::scheduled_micros_ = 0;
+AudioStreamWork::Stats AudioStreamWork::stats_;
 #define LOCK_SD(X) AudioStreamWork::LockSD(X)
 
 #endif
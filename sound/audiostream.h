@@ -3,9 +3,21 @@
 
 #include <stdint.h>
 
+// Volumes and gains are fixed point, kMaxVolume is 1.0.
+const uint32_t kVolumeShift = 14;
+const uint32_t kMaxVolume = 1 << kVolumeShift;
+
 class ProffieOSAudioStream {
 public:
   virtual int read(int16_t* data, int elements) = 0;
+  // Same as read(), but leaves the volume to the caller. |start| is set
+  // to the gain for the first sample, and |end| to the gain after the
+  // last sample, the gain changes linearly in between. The mixer uses
+  // this to apply the volume while summing the streams.
+  virtual int read_raw(int16_t* data, int elements, int32_t* start, int32_t* end) {
+    *start = *end = kMaxVolume;
+    return read(data, elements);
+  }
   // There is no need to call eof() unless read() returns zero elements.
   virtual bool eof() const { return false; }
   // Stop
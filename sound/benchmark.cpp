@@ -0,0 +1,643 @@
+// Host-side benchmark for the audio pipeline.
+//
+// Plays the .wav files found in a font directory through N
+// BufferedWavPlayers into an AudioDynamicMixer, the same way the
+// audio DMA interrupt and the PendSV fill routine would on a board,
+// and reports cycles per sample, per-stage cycles and underflows as JSON.
+//
+// Usage: ./benchmark [-n players] [-s seconds] [-starve N] [-tolerance T]
+//                    [-o out.json] [-v] [-effects] [-ram] [fontdir]
+//
+// If no font directory is given, a synthetic font is generated in
+// "benchfont" so that the numbers are repeatable without real fonts.
+// -starve N only runs the buffer fill routine every N audio blocks,
+// which simulates a busy SD card (LOCK_SD, blade streaming, etc.)
+// -effects plays random effects (with Effect::RandomFile()) instead of
+// going through the files in order, this also exercises the wav file cache.
+// -ram (with -effects) loads all effects into the wav RAM cache first.
+// -tolerance T fails (exit code 2) if the block compressor differs from
+// the per-sample compressor by more than T (RMS, fraction of full scale.)
+// "volume" compares applying volume fades in VolumeOverlay::read() with
+// applying them in the mixer (read_raw()), the results should be identical.
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdint.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <memory.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+uint64_t host_cycles() { return __rdtsc(); }
+#else
+uint64_t host_cycles() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+// cruft
+#define PROFFIE_TEST
+#define ENABLE_SD
+#define ENABLE_PROFILING
+#define NUM_BLADES 0
+#define VOLUME 1800
+
+#define AUDIO_BUFFER_SIZE 44
+#define AUDIO_RATE 44100
+#define NUM_WAV_PLAYERS 7
+#define WAV_RAM_CACHE_SIZE 65536
+
+#define NELEM(X) (sizeof(X)/sizeof((X)[0]))
+#define noInterrupts() do {} while(0)
+#define interrupts() do {} while(0)
+
+// Fake audio clock, advanced by the benchmark loop.
+uint64_t samples_played = 0;
+uint32_t micros() { return samples_played * 1000000 / AUDIO_RATE; }
+uint32_t millis() { return samples_played * 1000 / AUDIO_RATE; }
+
+float fract(float x) { return x - floorf(x); }
+float clamp(float x, float a, float b) {
+  if (x < a) return a;
+  if (x > b) return b;
+  return x;
+}
+float Fmod(float a, float b) {
+  return a - floorf(a / b) * b;
+}
+int32_t clampi32(int32_t x, int32_t a, int32_t b) {
+  if (x < a) return a;
+  if (x > b) return b;
+  return x;
+}
+int16_t clamptoi16(int32_t x) {
+  return clampi32(x, -32768, 32767);
+}
+
+char* itoa(int value, char *ret, int radix) {
+  sprintf(ret, "%d", value);
+  return ret;
+}
+
+// The DWT cycle counter, emulated with the host time stamp counter.
+// ScopedCycleCounter writes the counter back when a scope ends so that
+// enclosing scopes do not count the same cycles twice, so writes
+// adjust an offset instead.
+struct HostCycleRegister {
+  operator uint32_t() const { return host_cycles() - offset_; }
+  HostCycleRegister& operator=(uint32_t v) {
+    offset_ = host_cycles() - v;
+    return *this;
+  }
+  uint64_t offset_ = 0;
+};
+struct HostDWT {
+  HostCycleRegister CYCCNT;
+};
+HostDWT host_dwt;
+#define DWT (&host_dwt)
+
+uint64_t wav_interrupt_cycles = 0;
+
+// PendSV emulation. When called from the audio "interrupt", the
+// routine is deferred until the interrupt returns, otherwise it runs
+// right away, just like it would on the board.
+typedef void (*armv7m_pendsv_routine_t)(void*, uint32_t);
+bool in_audio_interrupt = false;
+armv7m_pendsv_routine_t pending_pendsv = nullptr;
+void armv7m_pendsv_enqueue(armv7m_pendsv_routine_t routine, void* context, uint32_t data) {
+  if (in_audio_interrupt) {
+    pending_pendsv = routine;
+  } else {
+    routine(context, data);
+  }
+}
+bool RunPendSV() {
+  armv7m_pendsv_routine_t routine = pending_pendsv;
+  pending_pendsv = nullptr;
+  if (!routine) return false;
+  routine(nullptr, 0);
+  return true;
+}
+
+void MountSDCard() {}
+void EnableAmplifier() {}
+
+#include "../common/monitoring.h"
+#include "../common/stdout.h"
+Print* default_output;
+Print* stdout_output;
+ConsoleHelper STDOUT;
+Monitoring monitor;
+
+#include "../common/scoped_cycle_counter.h"
+#include "../common/profiling.h"
+
+class Looper {
+public:
+  virtual const char* name() = 0;
+  virtual void Loop() = 0;
+  static void DoHFLoop() {}
+};
+
+struct SaberBase {
+  static float sound_length;
+  static int sound_number;
+};
+float SaberBase::sound_length = 0.0;
+int SaberBase::sound_number = -1;
+
+#include "../common/linked_ptr.h"
+#include "../common/strfun.h"
+#include "../common/lsfs.h"
+
+char current_directory[128] = "benchfont\0\0";
+const char *next_current_directory(const char *dir) {
+  return NULL;
+}
+
+struct TALKIEFAKE {
+  int IGNORE;
+};
+TALKIEFAKE talkie;
+#define Say(X,Y) IGNORE;
+
+#include "click_avoider_lin.h"
+#include "audiostream.h"
+#include "dynamic_mixer.h"
+#include "buffered_audio_stream.h"
+#include "effect.h"
+#include "buffered_wav_player.h"
+
+BufferedWavPlayer wav_players[NUM_WAV_PLAYERS];
+size_t WhatUnit(class BufferedWavPlayer* player) {
+  if (!player) return -1;
+  return player - wav_players;
+}
+
+void WriteWav(const char* filename, int rate, int channels, int bits,
+              float seconds, float freq, float noise) {
+  FILE* f = fopen(filename, "wb");
+  if (!f) { perror(filename); exit(1); }
+  uint32_t samples = rate * seconds;
+  uint32_t data_bytes = samples * channels * bits / 8;
+  uint32_t header[] = {
+    0x46464952, 36 + data_bytes, 0x45564157,
+    0x20746D66, 16,
+    (uint32_t)(1 | (channels << 16)),
+    (uint32_t)rate,
+    (uint32_t)(rate * channels * bits / 8),
+    (uint32_t)((channels * bits / 8) | (bits << 16)),
+    0x61746164, data_bytes,
+  };
+  fwrite(header, sizeof(header), 1, f);
+  for (uint32_t i = 0; i < samples; i++) {
+    float v = sinf(i * freq * 2.0 * M_PI / rate) * 0.6 +
+      noise * ((rand() & 0xffff) / 32768.0 - 1.0);
+    for (int c = 0; c < channels; c++) {
+      int s = clamptoi16(v * 32767);
+      if (bits == 8) {
+        fputc((s >> 8) + 128, f);
+      } else {
+        fputc(s & 0xff, f);
+        fputc((s >> 8) & 0xff, f);
+      }
+    }
+  }
+  fclose(f);
+}
+
+// Mono IMA ADPCM, same layout as adpcm_tools/wavtoadpcm writes.
+// Returns the number of samples written.
+uint32_t WriteADPCMWav(const char* filename, int rate, float seconds,
+                   float freq, float noise) {
+  FILE* f = fopen(filename, "wb");
+  if (!f) { perror(filename); exit(1); }
+  const uint32_t block_align = 512;
+  const uint32_t samples_per_block = (block_align - 4) * 2 + 1;
+  uint32_t samples = rate * seconds;
+  uint32_t blocks = samples / samples_per_block;
+  uint32_t data_bytes = blocks * block_align;
+  uint32_t header[] = {
+    0x46464952, 36 + data_bytes, 0x45564157,
+    0x20746D66, 16,
+    (uint32_t)(IMA_ADPCM_FORMAT | (1 << 16)),
+    (uint32_t)rate,
+    (uint32_t)(rate * block_align / samples_per_block),
+    (uint32_t)(block_align | (4 << 16)),
+    0x61746164, data_bytes,
+  };
+  fwrite(header, sizeof(header), 1, f);
+  IMAADPCMChannel state;
+  uint32_t i = 0;
+  for (uint32_t b = 0; b < blocks; b++) {
+    unsigned char block[block_align];
+    for (uint32_t j = 0; j < samples_per_block; j++, i++) {
+      float v = sinf(i * freq * 2.0 * M_PI / rate) * 0.6 +
+        noise * ((rand() & 0xffff) / 32768.0 - 1.0);
+      int16_t s = clamptoi16(v * 32767);
+      if (j == 0) {
+        state.WriteHeader(block, s);
+      } else {
+        int code = state.Encode(s);
+        unsigned char* p = block + 4 + (j - 1) / 2;
+        if (j & 1) *p = code; else *p |= code << 4;
+      }
+    }
+    fwrite(block, block_align, 1, f);
+  }
+  fclose(f);
+  return blocks * samples_per_block;
+}
+
+void MakeSyntheticFont(const char* dir) {
+  mkdir(dir, 0777);
+  std::string d(dir);
+  srand(1);
+  WriteWav((d + "/hum.wav").c_str(), 44100, 1, 16, 2.0, 110.0, 0.05);
+  WriteWav((d + "/clash1.wav").c_str(), 44100, 1, 16, 0.5, 880.0, 0.4);
+  WriteWav((d + "/clash2.wav").c_str(), 22050, 1, 16, 0.5, 660.0, 0.4);
+  WriteWav((d + "/blst1.wav").c_str(), 44100, 2, 16, 0.4, 440.0, 0.3);
+  WriteWav((d + "/swingl.wav").c_str(), 22050, 1, 8, 1.5, 220.0, 0.1);
+  WriteWav((d + "/swingh.wav").c_str(), 11025, 1, 16, 1.5, 330.0, 0.1);
+  WriteADPCMWav((d + "/force1.wav").c_str(), 22050, 1.0, 550.0, 0.1);
+}
+
+void FindWavFiles(const std::string& dir, std::vector<std::string>* files, int depth) {
+  DIR* d = opendir(dir.c_str());
+  if (!d) return;
+  while (dirent* e = readdir(d)) {
+    if (e->d_name[0] == '.') continue;
+    std::string name = dir + "/" + e->d_name;
+    struct stat s;
+    if (stat(name.c_str(), &s)) continue;
+    if (S_ISDIR(s.st_mode)) {
+      if (depth < 2) FindWavFiles(name, files, depth + 1);
+    } else if (endswith(".wav", e->d_name)) {
+      files->push_back(name);
+    }
+  }
+  closedir(d);
+  std::sort(files->begin(), files->end());
+}
+
+// Runs the per-sample reference compressor and the block compressor
+// on the same input and measures how far apart they are.
+struct CompressorComparison {
+  double reference_cycles_per_sample = 0;
+  double block_cycles_per_sample = 0;
+  double max_error = 0;   // fraction of full scale
+  double rms_error = 0;   // fraction of full scale
+};
+
+CompressorComparison CompareCompressors(float seconds) {
+  CompressorComparison ret;
+  AudioDynamicMixer<1> reference, block;
+  int32_t sum[AUDIO_BUFFER_SIZE];
+  int16_t a[AUDIO_BUFFER_SIZE], b[AUDIO_BUFFER_SIZE];
+  uint64_t reference_cycles = 0, block_cycles = 0;
+  uint64_t samples = seconds * AUDIO_RATE;
+  double error_sum = 0;
+  uint64_t n = 0;
+  srand(2);
+  while (n < samples) {
+    for (size_t i = 0; i < NELEM(sum); i++) {
+      float t = (n + i) / (float)AUDIO_RATE;
+      // Bursts of increasing loudness, with some silence in between.
+      // (The reference compressor overflows if the average volume
+      // stays above ~33000 for long, so stay below that.)
+      float envelope = fmodf(t, 1.0f) < 0.8f ? fmodf(t, 1.0f) * fmodf(t, 4.0f) / 4 : 0.0f;
+      float v = sinf(t * 2 * M_PI * 110) + 0.5 * sinf(t * 2 * M_PI * 1234) +
+        0.2 * ((rand() & 0xffff) / 32768.0 - 1.0);
+      sum[i] = v * envelope * 32768;
+    }
+    uint64_t start = host_cycles();
+    reference.Compress(sum, a, NELEM(sum));
+    uint64_t mid = host_cycles();
+    block.CompressBlocks(sum, b, NELEM(sum));
+    uint64_t end = host_cycles();
+    reference_cycles += mid - start;
+    block_cycles += end - mid;
+    // Skip the first second while the average volume settles.
+    if (n >= AUDIO_RATE) {
+      for (size_t i = 0; i < NELEM(sum); i++) {
+        double e = (a[i] - b[i]) / 32768.0;
+        ret.max_error = std::max(ret.max_error, fabs(e));
+        error_sum += e * e;
+      }
+    }
+    n += NELEM(sum);
+  }
+  ret.reference_cycles_per_sample = reference_cycles / (double)n;
+  ret.block_cycles_per_sample = block_cycles / (double)n;
+  ret.rms_error = sqrt(error_sum / (n - AUDIO_RATE));
+  return ret;
+}
+
+// Applies volume fades to the same signal with VolumeOverlay::read()
+// followed by Accumulate(), which is how the mixer used to do it, and
+// with read_raw() and AccumulateGain(), which is what the mixer does now.
+// The volume stays below 1.0, so that the old way never clamps.
+struct VolumeComparison {
+  double separate_cycles_per_sample = 0;
+  double fused_cycles_per_sample = 0;
+  int max_error = 0;   // in 16-bit steps
+};
+
+class SineStream : public ProffieOSAudioStream {
+public:
+  SineStream() {
+    // 441Hz, so that the table is exactly one period.
+    for (size_t i = 0; i < NELEM(table_); i++) {
+      table_[i] = sinf(i * 2 * M_PI / NELEM(table_)) * 32767;
+    }
+  }
+  int read(int16_t* data, int elements) override {
+    for (int i = 0; i < elements; i++) {
+      data[i] = table_[n_];
+      if (++n_ == NELEM(table_)) n_ = 0;
+    }
+    return elements;
+  }
+private:
+  int16_t table_[100];
+  size_t n_ = 0;
+};
+
+VolumeComparison CompareVolume(float seconds) {
+  VolumeComparison ret;
+  VolumeOverlay<SineStream> separate, fused;
+  int32_t a[AUDIO_BUFFER_SIZE], b[AUDIO_BUFFER_SIZE];
+  int16_t tmp[AUDIO_BUFFER_SIZE];
+  uint64_t separate_cycles = 0, fused_cycles = 0;
+  uint64_t samples = seconds * AUDIO_RATE;
+  uint64_t n = 0;
+  srand(3);
+  for (int block = 0; n < samples; block++) {
+    if (block % 50 == 0) {
+      // New target volume and fade time every 50 blocks.
+      int volume = rand() % kMaxVolume;
+      float fade = (1 + rand() % 100) / 1000.0f;
+      separate.set_fade_time(fade);
+      fused.set_fade_time(fade);
+      separate.set_volume(volume);
+      fused.set_volume(volume);
+    }
+    memset(a, 0, sizeof(a));
+    memset(b, 0, sizeof(b));
+    uint64_t start = host_cycles();
+    int e = separate.read(tmp, NELEM(tmp));
+    AudioDynamicMixer<1>::Accumulate(a, tmp, e);
+    uint64_t mid = host_cycles();
+    for (int done = 0; done < (int)NELEM(tmp); done += e) {
+      int32_t gain_start, gain_end;
+      e = fused.read_raw(tmp + done, NELEM(tmp) - done, &gain_start, &gain_end);
+      AudioDynamicMixer<1>::AccumulateGain(b + done, tmp + done, e, gain_start, gain_end);
+    }
+    uint64_t end = host_cycles();
+    separate_cycles += mid - start;
+    fused_cycles += end - mid;
+    for (size_t i = 0; i < NELEM(a); i++) {
+      ret.max_error = std::max<int>(ret.max_error, abs(a[i] - b[i]));
+    }
+    n += NELEM(a);
+  }
+  ret.separate_cycles_per_sample = separate_cycles / (double)n;
+  ret.fused_cycles_per_sample = fused_cycles / (double)n;
+  return ret;
+}
+
+// Plays a file all the way through and counts the samples.
+uint32_t DecodedLength(const char* filename) {
+  static PlayWav player;
+  int16_t buffer[AUDIO_BUFFER_SIZE];
+  uint32_t ret = 0;
+  player.Play(filename);
+  // Reads return nothing until the header has been read.
+  for (int i = 0; i < 1000000 && player.isPlaying(); i++) {
+    ret += player.read(buffer, NELEM(buffer));
+  }
+  player.Stop();
+  player.Close();
+  return ret;
+}
+
+// The last ADPCM frame of a file used to be dropped.
+bool CheckADPCMLength() {
+  const char* filename = "adpcm_length.wav";
+  uint32_t expected = WriteADPCMWav(filename, AUDIO_RATE, 0.5, 440.0, 0.1);
+  uint32_t decoded = DecodedLength(filename);
+  unlink(filename);
+  if (decoded != expected) {
+    fprintf(stderr, "%s: decoded %u samples, expected %u\n",
+            filename, (unsigned)decoded, (unsigned)expected);
+    return false;
+  }
+  return true;
+}
+
+void PrintJSONString(FILE* f, const char* s) {
+  fputc('"', f);
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\') fputc('\\', f);
+    fputc(*s, f);
+  }
+  fputc('"', f);
+}
+
+int main(int argc, char** argv) {
+  int num_players = 4;
+  float seconds = 10.0;
+  int starve = 1;
+  bool verbose = false;
+  bool effects = false;
+  bool ram = false;
+  float tolerance = -1.0;
+  const char* output = nullptr;
+  const char* fontdir = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+      num_players = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "-starve") && i + 1 < argc) {
+      starve = std::max(1, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "-tolerance") && i + 1 < argc) {
+      tolerance = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+      output = argv[++i];
+    } else if (!strcmp(argv[i], "-v")) {
+      verbose = true;
+    } else if (!strcmp(argv[i], "-effects")) {
+      effects = true;
+    } else if (!strcmp(argv[i], "-ram")) {
+      ram = true;
+    } else if (argv[i][0] != '-') {
+      fontdir = argv[i];
+    } else {
+      fprintf(stderr, "Usage: %s [-n players] [-s seconds] [-starve N] [-tolerance T] [-o out.json] [-v] [-effects] [-ram] [fontdir]\n", argv[0]);
+      return 1;
+    }
+  }
+  num_players = clampi32(num_players, 1, NUM_WAV_PLAYERS);
+
+  if (!fontdir) {
+    fontdir = "benchfont";
+    MakeSyntheticFont(fontdir);
+  }
+  std::vector<std::string> files;
+  FindWavFiles(fontdir, &files, 0);
+  if (files.empty()) {
+    fprintf(stderr, "No .wav files found in %s\n", fontdir);
+    return 1;
+  }
+
+  // PlayWav and friends print to stdout, keep that out of the JSON.
+  FILE* json = output ? fopen(output, "w") : fdopen(dup(1), "w");
+  if (!json) { perror(output); return 1; }
+  if (!verbose) {
+    if (!freopen("/dev/null", "w", stdout)) return 1;
+  }
+
+  if (!CheckADPCMLength()) return 3;
+
+  for (int i = 0; i < num_players; i++) {
+    dynamic_mixer.streams_[i] = wav_players + i;
+  }
+
+  // With -effects, play effects the way HybridFont does, which also
+  // goes through the wav file cache.
+  std::vector<Effect*> effect_list;
+  if (effects) {
+    strcpy(current_directory, fontdir);
+    Effect::ScanCurrentDirectory();
+    for (Effect* e = all_effects; e; e = e->next_) {
+      // Looping effects (hum) would keep a player busy forever.
+      if (e->files_found() && !e->GetFollowing()) effect_list.push_back(e);
+    }
+    if (effect_list.empty()) {
+      fprintf(stderr, "No effects found in %s\n", fontdir);
+      return 1;
+    }
+    wav_file_cache.Prefetch(&SFX_clash);
+    if (ram) {
+      wav_ram_cache.Clear();
+      for (Effect* e : effect_list) wav_ram_cache.Add(e);
+    }
+  }
+
+  size_t next_file = 0;
+  uint64_t files_played = 0;
+  uint64_t total_samples = seconds * AUDIO_RATE;
+  uint64_t interrupt_cycles = 0;
+  uint64_t fill_cycles = 0;
+  uint64_t blocks = 0;
+  uint32_t checksum = 2166136261U;
+  int32_t peak = 0;
+  int16_t buffer[AUDIO_BUFFER_SIZE];
+
+  while (samples_played < total_samples) {
+    for (int i = 0; i < num_players; i++) {
+      if (!wav_players[i].isPlaying()) {
+        if (effects) {
+          Effect* e = effect_list[next_file++ % effect_list.size()];
+          wav_players[i].PlayOnce(e);
+        } else {
+          wav_players[i].Play(files[next_file++ % files.size()].c_str());
+        }
+        files_played++;
+      }
+    }
+
+    uint64_t start = host_cycles();
+    in_audio_interrupt = true;
+    int n = dynamic_mixer.read(buffer, NELEM(buffer));
+    in_audio_interrupt = false;
+    uint64_t mid = host_cycles();
+    interrupt_cycles += mid - start;
+
+    if (++blocks % starve == 0) {
+      RunPendSV();
+      fill_cycles += host_cycles() - mid;
+    }
+
+    for (int i = 0; i < n; i++) {
+      checksum = (checksum ^ (uint16_t)buffer[i]) * 16777619U;
+      peak = std::max<int32_t>(peak, abs(buffer[i]));
+    }
+    samples_played += n;
+  }
+
+  // The comparisons below run more profiled code, so take the stages
+  // of the main pipeline first.
+  std::vector<std::pair<ProfileLocation*, uint64_t>> stages;
+  for (ProfileLocation* p = profile_locations_; p; p = p->next_) {
+    stages.push_back(std::make_pair(p, p->cycles_));
+  }
+
+  CompressorComparison compressor = CompareCompressors(seconds);
+  VolumeComparison volume = CompareVolume(seconds);
+
+  uint64_t total_cycles = interrupt_cycles + fill_cycles;
+  fprintf(json, "{\n");
+  fprintf(json, "  \"font\": ");
+  PrintJSONString(json, fontdir);
+  fprintf(json, ",\n");
+  fprintf(json, "  \"players\": %d,\n", num_players);
+  fprintf(json, "  \"starve\": %d,\n", starve);
+  fprintf(json, "  \"samples\": %llu,\n", (unsigned long long)samples_played);
+  fprintf(json, "  \"files_played\": %llu,\n", (unsigned long long)files_played);
+  fprintf(json, "  \"cycles_per_sample\": %.2f,\n", total_cycles / (double)samples_played);
+  fprintf(json, "  \"mixer_interrupt_cycles_per_sample\": %.2f,\n", interrupt_cycles / (double)samples_played);
+  fprintf(json, "  \"fill_cycles_per_sample\": %.2f,\n", fill_cycles / (double)samples_played);
+  fprintf(json, "  \"underflows\": %u,\n", (unsigned)dynamic_mixer.underflow_count_);
+  const AudioStreamWork::Stats& stream_stats = AudioStreamWork::stats();
+  fprintf(json, "  \"scheduler\": { \"fills\": %u, \"max_latency_micros\": %u, "
+          "\"min_slack\": %u, \"stream_underflows\": %u },\n",
+          (unsigned)stream_stats.fills, (unsigned)stream_stats.max_latency_micros,
+          (unsigned)stream_stats.min_slack, (unsigned)stream_stats.underflows);
+  fprintf(json, "  \"wav_file_cache\": { \"hits\": %u, \"misses\": %u },\n",
+          (unsigned)wav_file_cache.hits(), (unsigned)wav_file_cache.misses());
+  fprintf(json, "  \"wav_ram_cache\": { \"hits\": %u },\n", (unsigned)wav_ram_cache.hits());
+  fprintf(json, "  \"peak\": %d,\n", peak);
+  fprintf(json, "  \"checksum\": \"%08x\",\n", checksum);
+  fprintf(json, "  \"compressor\": { \"block_size\": %d, \"reference_cycles_per_sample\": %.2f, "
+          "\"block_cycles_per_sample\": %.2f, \"max_error\": %.6f, \"rms_error\": %.6f },\n",
+          DYNAMIC_MIXER_BLOCK_SIZE,
+          compressor.reference_cycles_per_sample, compressor.block_cycles_per_sample,
+          compressor.max_error, compressor.rms_error);
+  fprintf(json, "  \"volume\": { \"separate_cycles_per_sample\": %.2f, "
+          "\"fused_cycles_per_sample\": %.2f, \"max_error\": %d },\n",
+          volume.separate_cycles_per_sample, volume.fused_cycles_per_sample,
+          volume.max_error);
+  fprintf(json, "  \"stages\": [");
+  bool first = true;
+  for (const auto& stage : stages) {
+    fprintf(json, "%s\n    { \"function\": ", first ? "" : ",");
+    PrintJSONString(json, stage.first->func_);
+    fprintf(json, ", \"location\": ");
+    PrintJSONString(json, stage.first->location_);
+    fprintf(json, ", \"cycles\": %llu, \"cycles_per_sample\": %.2f }",
+            (unsigned long long)stage.second, stage.second / (double)samples_played);
+    first = false;
+  }
+  fprintf(json, "\n  ]\n}\n");
+  fclose(json);
+  if (tolerance >= 0.0 && compressor.rms_error > tolerance) {
+    fprintf(stderr, "Block compressor error %f exceeds tolerance %f\n",
+            compressor.rms_error, tolerance);
+    return 2;
+  }
+  return 0;
+}
@@ -35,6 +35,10 @@ public:
       buf += to_copy;
       bufsize -= to_copy;
     }
+    if (bufsize && stream_ && !eof_) CountUnderflow();
+    // Streams that haven't been filled yet, or which are just
+    // draining what's left, are not close to running dry.
+    if (copied && stream_ && !eof_) RecordSlack(buffered());
     scheduleFillBuffer();
     return copied;
 #endif
@@ -58,6 +62,9 @@ public:
   size_t space_available() const override {
     return real_space_available();
   }
+  uint32_t deadline() const override {
+    return buffered();
+  }
   void SetStream(ProffieOSAudioStream* stream) {
     stop_requested_ = false;
     eof_ = false;
@@ -69,6 +76,7 @@ private:
     return N - buffered();
   }
   bool FillBuffer() override {
+    SCOPED_PROFILER();
     if (stream_) {
       if (stop_requested_) {
 	stop_requested_ = false;
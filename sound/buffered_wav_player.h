@@ -80,6 +80,33 @@ public:
     clear();
   }
 
+  // Stops the current sound right away, so that the player can be
+  // used for something else. To avoid a click, the next audio block
+  // of the old sound is faded out and played before the new sound.
+  void CutOff() {
+    pause_ = true;
+    // If the last cut-off is still playing, the old sound has barely
+    // started, so it is just dropped.
+    if (tail_pos_ == tail_len_) {
+      int n = 0;
+      while (n < AUDIO_BUFFER_SIZE) {
+        int32_t start, end;
+        int got = VolumeOverlay<BufferedAudioStream<AUDIO_BUFFER_SIZE_BYTES> >::read_raw(tail_ + n, AUDIO_BUFFER_SIZE - n, &start, &end);
+        if (!got) break;
+        for (int i = 0; i < got; i++) {
+          int32_t gain = start + (end - start) * i / got;
+          int32_t v = (tail_[n + i] * gain) >> kVolumeShift;
+          tail_[n + i] = clamptoi16(v * (AUDIO_BUFFER_SIZE - n - i) / AUDIO_BUFFER_SIZE);
+        }
+        n += got;
+      }
+      tail_len_ = n;
+      tail_pos_ = 0;
+    }
+    Stop();
+    reset_volume();
+  }
+
   void CloseFiles() override { wav.Close(); }
 
   const char* Filename() const {
@@ -89,6 +116,9 @@ public:
   Effect::FileID current_file_id() const {
     return wav.current_file_id();
   }
+
+  // True if the current file is in wav_ram_cache.
+  bool from_ram() const { return wav.from_ram(); }
   
   bool isPlaying() const {
     return !pause_ && (wav.isPlaying() || buffered());
@@ -105,12 +135,28 @@ public:
     if (pause_ && ret) ret = 2; // still slightly higher than FromFileStyle<>
     return ret;
   }
+  uint32_t deadline() const override {
+    // Nobody is waiting for a paused player, but it should still
+    // come before FromFileStyle<>.
+    if (pause_) return kLowPriority - 1;
+    return VolumeOverlay<BufferedAudioStream<AUDIO_BUFFER_SIZE_BYTES>>::deadline();
+  }
 
   int read(int16_t* dest, int to_read) override {
+    if (tail_pos_ != tail_len_) return ReadTail(dest, to_read);
     if (pause_) return 0;
     return VolumeOverlay<BufferedAudioStream<AUDIO_BUFFER_SIZE_BYTES> >::read(dest, to_read);
   }
+  int read_raw(int16_t* dest, int to_read, int32_t* start, int32_t* end) override {
+    if (tail_pos_ != tail_len_) {
+      *start = *end = kMaxVolume;
+      return ReadTail(dest, to_read);
+    }
+    if (pause_) return 0;
+    return VolumeOverlay<BufferedAudioStream<AUDIO_BUFFER_SIZE_BYTES> >::read_raw(dest, to_read, start, end);
+  }
   bool eof() const override {
+    if (tail_pos_ != tail_len_) return false;
     if (pause_) return true;
     return VolumeOverlay<BufferedAudioStream<AUDIO_BUFFER_SIZE_BYTES> >::eof();
   }
@@ -136,8 +182,23 @@ public:
     wav.dump();
   }
 private:
+  int ReadTail(int16_t* dest, int to_read) {
+    int n = std::min<int>(to_read, tail_len_ - tail_pos_);
+    memcpy(dest, tail_ + tail_pos_, n * sizeof(dest[0]));
+    tail_pos_ += n;
+    return n;
+  }
+
   uint32_t refs_ = 0;
 
+  // Faded out end of a sound that was cut off, see CutOff().
+  // Only the main loop writes tail_ and tail_len_, and only while
+  // tail_pos_ == tail_len_, that is, while the audio interrupt
+  // doesn't read them.
+  int16_t tail_[AUDIO_BUFFER_SIZE];
+  volatile int tail_len_ = 0;
+  volatile int tail_pos_ = 0;
+
   PlayWav wav;
   volatile bool pause_;
 };
@@ -25,6 +25,19 @@ public:
       return;
     }
   }
+  // Same as calling advance() |n| times.
+  void advance(int n) {
+    uint32_t target = target_;
+    uint32_t delta = speed_ * n;
+    if (current_ > target) {
+      current_ -= std::min(delta, current_ - target);
+      return;
+    }
+    if (current_ < target) {
+      current_ += std::min(delta, target - current_);
+      return;
+    }
+  }
   bool isConstant() const {
     return current_ == target_;
   }
@@ -3,6 +3,29 @@
 
 #include <algorithm>
 
+// Number of samples that share one envelope and gain calculation
+// in the compressor. 1 means that the gain is calculated for every
+// sample, which is slower, but bit-exact with older versions.
+#ifndef DYNAMIC_MIXER_BLOCK_SIZE
+#define DYNAMIC_MIXER_BLOCK_SIZE 8
+#endif
+
+// Saturate to 16 bits and pack two 16-bit samples into one word.
+// Cortex-M4 has single-cycle instructions for both.
+#if defined(__ARM_FEATURE_DSP) && !defined(TEENSYDUINO)
+#define MIXER_SAT16(X) __SSAT((X), 16)
+#define MIXER_PACK16(LO, HI) __PKHBT((LO), (HI), 16)
+#else
+#define MIXER_SAT16(X) clamptoi16(X)
+#define MIXER_PACK16(LO, HI) (((uint32_t)(LO) & 0xffff) | ((uint32_t)(HI) << 16))
+#endif
+
+// (255/256)^n in 16.16 fixed point, this is how much the average
+// volume decays over n samples.
+constexpr uint32_t MixerDecay(int n) {
+  return n == 0 ? 65536 : MixerDecay(n - 1) * 255 / 256;
+}
+
 // Audio compressor, takes N input channels, sums them and divides the
 // result by the square root of the average volume.
 template<int N> class AudioDynamicMixer : public ProffieOSAudioStream, Looper {
@@ -54,46 +77,157 @@ public:
   }
   int last_square_ = 0;
 #endif
+
+  // Gain for CompressBlock(), in 16.16 fixed point. The average volume
+  // moves too much from one block to the next for the guess in
+  // my_sqrt() to help, and the search then costs more than the rest of
+  // the block, so use the FPU when there is one.
+  int32_t BlockGain() {
+#if !defined(__arm__) || defined(__ARM_FP)
+    return ((uint32_t)volume_ << 16) / (uint32_t)((int)sqrtf(vol_) + 100);
+#else
+    return ((uint32_t)volume_ << 16) / (uint32_t)(my_sqrt(vol_) + 100);
+#endif
+  }
   
   int read(int16_t* data, int elements) override {
     SCOPED_PROFILER();
     int32_t sum[AUDIO_BUFFER_SIZE];
     int ret = elements;
-    int v = 0, v2 = 0;
     num_samples_ += elements;
     while (elements) {
       int to_do = std::min(elements, (int)NELEM(sum));
       for (int i = 0; i < to_do; i++) sum[i] = 0;
       for (int i = 0; i < N; i++) {
 	if (!streams_[i]) continue;
-        int e = streams_[i]->read(data, to_do);
+        // read_raw() returns early when a volume fade ends.
+        int e = 0;
+        while (e < to_do) {
+          int32_t start, end;
+          int got = streams_[i]->read_raw(data + e, to_do - e, &start, &end);
+          if (!got) break;
+          AccumulateGain(sum + e, data + e, got, start, end);
+          e += got;
+        }
 	if (e < to_do && !streams_[i]->eof()) {
 	  underflow_count_++;
 	}
-        for (int j = 0; j < e; j++) {
-          sum[j] += data[j];
-        }
       }
 
-      for (int i = 0; i < to_do; i++) {
-        v = sum[i];
-        vol_ = ((vol_ + abs(v)) * 255) >> 8;
-        v2 = v * volume_ / (my_sqrt(vol_) + 100);
-//	v2 = (int)((v * (float)volume_)/(sqrtf(vol_)+100.0f));
-        data[i] = clamptoi16(v2);
-        peak_sum_ = std::max<int32_t>(abs(v), peak_sum_);
-        peak_ = std::max<int32_t>(abs(v2), peak_);
-      }
+#if DYNAMIC_MIXER_BLOCK_SIZE > 1
+      CompressBlocks(sum, data, to_do);
+#else
+      Compress(sum, data, to_do);
+#endif
       data += to_do;
       elements -= to_do;
     }
-    last_sample_ = v2;
-    last_sum_ = v;
     
 //    STDOUT.println(vol_);
     return ret;
   }
 
+  // Divides |to_do| summed samples by the square root of the
+  // running average volume and writes the result to |data|.
+  void Compress(const int32_t* sum, int16_t* data, int to_do) {
+    SCOPED_PROFILER();
+    int v = 0, v2 = 0;
+    for (int i = 0; i < to_do; i++) {
+      v = sum[i];
+      vol_ = ((vol_ + abs(v)) * 255) >> 8;
+      v2 = v * volume_ / (my_sqrt(vol_) + 100);
+//    v2 = (int)((v * (float)volume_)/(sqrtf(vol_)+100.0f));
+      data[i] = clamptoi16(v2);
+      peak_sum_ = std::max<int32_t>(abs(v), peak_sum_);
+      peak_ = std::max<int32_t>(abs(v2), peak_);
+    }
+    last_sample_ = v2;
+    last_sum_ = v;
+  }
+
+  // Adds |e| samples to |sum|, two samples per word read.
+  static void Accumulate(int32_t* sum, const int16_t* data, int e) {
+    int j = 0;
+    for (; j + 1 < e; j += 2) {
+      uint32_t w;
+      memcpy(&w, data + j, sizeof(w));
+      sum[j] += (int16_t)w;
+      sum[j + 1] += (int32_t)w >> 16;
+    }
+    if (j < e) sum[j] += data[j];
+  }
+
+  // Adds |e| samples to |sum|, multiplied by a gain which goes
+  // linearly from |start| towards |end|. (See read_raw().)
+  // Nothing is clamped until the compressor, so loud streams
+  // don't clip before they are mixed.
+  static void AccumulateGain(int32_t* sum, const int16_t* data, int e,
+                             int32_t start, int32_t end) {
+    if (e <= 0) return;
+    if (start == end) {
+      if (start == (int32_t)kMaxVolume) {
+        Accumulate(sum, data, e);
+      } else if (start) {
+        for (int j = 0; j < e; j++) sum[j] += (data[j] * start) >> kVolumeShift;
+      }
+      return;
+    }
+    // 8 extra fractional bits, so that slow fades are exact.
+    int32_t g = start << 8;
+    int32_t step = ((end - start) << 8) / e;
+    for (int j = 0; j < e; j++) {
+      sum[j] += (data[j] * (g >> 8)) >> kVolumeShift;
+      g += step;
+    }
+  }
+
+  // Same as Compress(), but the average volume and the gain are only
+  // calculated once per DYNAMIC_MIXER_BLOCK_SIZE samples. The gain is
+  // ramped linearly from the previous block to avoid zipper noise.
+  void CompressBlocks(const int32_t* sum, int16_t* data, int to_do) {
+    SCOPED_PROFILER();
+    const int B = DYNAMIC_MIXER_BLOCK_SIZE;
+    static_assert((B & 1) == 0, "DYNAMIC_MIXER_BLOCK_SIZE must be even");
+    int i = 0;
+    for (; i + B <= to_do; i += B) CompressBlock(sum + i, data + i, B);
+    if (i < to_do) CompressBlock(sum + i, data + i, to_do - i);
+    if (to_do) {
+      last_sum_ = sum[to_do - 1];
+      last_sample_ = data[to_do - 1];
+    }
+  }
+
+  // Inlined so that the divisions by |n| become constant for full blocks.
+  inline void CompressBlock(const int32_t* s, int16_t* data, int n) __attribute__((always_inline)) {
+    uint32_t abs_sum = 0;
+    int32_t max_abs = 0;
+    for (int j = 0; j < n; j++) {
+      int32_t a = abs(s[j]);
+      abs_sum += a;
+      max_abs = std::max(max_abs, a);
+    }
+    uint32_t decay = MixerDecay(n);
+    vol_ = ((int64_t)vol_ * decay + (int64_t)(abs_sum * 255 / n) * (65536 - decay)) >> 16;
+    int32_t gain = BlockGain();
+    int32_t g = gain_;
+    int32_t step = (gain - g) / n;
+    peak_sum_ = std::max(peak_sum_, max_abs);
+    peak_ = std::max<int32_t>(peak_, std::min<int64_t>(32767, ((int64_t)max_abs * std::max(g, gain)) >> 16));
+    gain_ = gain;
+    int j = 0;
+    for (; j + 1 < n; j += 2) {
+      g += step;
+      int32_t a = MIXER_SAT16(((int64_t)s[j] * g) >> 16);
+      g += step;
+      int32_t b = MIXER_SAT16(((int64_t)s[j + 1] * g) >> 16);
+      uint32_t w = MIXER_PACK16(a, b);
+      memcpy(data + j, &w, sizeof(w));
+    }
+    if (j < n) {
+      data[j] = MIXER_SAT16(((int64_t)s[j] * gain) >> 16);
+    }
+  }
+
   // No volume, no clamping!
   int read(float* data, int elements) {
     SCOPED_PROFILER();
@@ -180,6 +314,8 @@ public:
 
   ProffieOSAudioStream* streams_[N];
   int32_t vol_ = 0;
+  // Gain used for the last sample, in 16.16 fixed point.
+  int32_t gain_ = 0;
   int32_t last_sample_ = 0;
   int32_t last_sum_ = 0;
   int32_t peak_sum_ = 0;
@@ -4,6 +4,10 @@
 #include <algorithm>
 #include "../common/file_reader.h"
 
+#ifndef FONT_INDEX_FILENAME
+#define FONT_INDEX_FILENAME "font.idx"
+#endif
+
 class Effect;
 Effect* all_effects = NULL;
 
@@ -32,8 +36,8 @@ class Effect {
 
     operator bool() const { return effect_ != nullptr; }
 
-    void GetName(char *filename) {
-      effect_->GetName(filename, file_);
+    void GetName(char *filename, bool verbose = true) {
+      effect_->GetName(filename, file_, verbose);
     }
 
     const Effect* GetEffect() const { return effect_; }
@@ -83,6 +87,16 @@ class Effect {
     UNKNOWN,
   };
 
+  // When we run out of wav players, a sound can take over a player
+  // which is playing a sound with lower priority.
+  enum class Priority : uint8_t {
+    MENU,
+    SWING,
+    BLAST,
+    NORMAL,   // clash, ignition and most other sounds
+    LOOP,     // hum, lockup and other loops
+  };
+
   static FileType GetFileType(Extension x) {
     switch (x) {
       case WAV:
@@ -110,9 +124,11 @@ class Effect {
 
   Effect(const char* name,
 	 Effect* following = nullptr,
-	 FileType file_type = FileType::SOUND) : name_(name) {
+	 FileType file_type = FileType::SOUND,
+	 Priority priority = Priority::NORMAL) : name_(name) {
     following_ = following;
     file_type_ = file_type;
+    priority_ = following == this ? Priority::LOOP : priority;
     next_ = all_effects;
     all_effects = this;
     reset();
@@ -126,6 +142,7 @@ class Effect {
     file_pattern_ = FilePattern::UNKNOWN;
     ext_ = UNKNOWN;
     selected_ = -1;
+    next_random_ = -1;
     num_files_ = 0;
     directory_ = nullptr;
     volume_ = 100;
@@ -282,24 +299,27 @@ class Effect {
     int n;
     if (selected_ != -1) {
       n = selected_;
+    } else if (next_random_ >= 0 && next_random_ < num_files) {
+      n = next_random_;
+      next_random_ = -1;
     } else {
-      n = rand() % num_files;
-#ifdef NO_REPEAT_RANDOM
-      switch (num_files) {
-      default:
-	while (n == last_) n = rand() % num_files;
-	break;
-      case 2:
-	if (n == last_) n = rand() % num_files;
-      case 1:
-	break;
-      }
-      last_ = n;
-#endif
+      n = PickRandom(num_files);
     }
     return FileID(this, n);
   }
 
+  // Returns the file that the next call to RandomFile() will return,
+  // so that it can be opened ahead of time.
+  FileID PeekRandomFile() {
+    int num_files = files_found();
+    if (num_files < 1) return FileID();
+    if (selected_ != -1) return FileID(this, selected_);
+    if (next_random_ < 0 || next_random_ >= num_files) {
+      next_random_ = PickRandom(num_files);
+    }
+    return FileID(this, next_random_);
+  }
+
   bool Play(char *filename) {
     FileID f = RandomFile();
     if (f == FileID()) return false;
@@ -308,7 +328,7 @@ class Effect {
   }
 
   // Get the name of a specific file in the set.
-  void GetName(char *filename, int n) const {
+  void GetName(char *filename, int n, bool verbose = true) const {
     strcpy(filename, directory_);
     if (*directory_) strcat(filename, "/");
     strcat(filename, name_);
@@ -348,6 +368,7 @@ class Effect {
       default: break;
     }
 
+    if (!verbose) return;
     default_output->print("Playing ");
     default_output->println(filename);
   }
@@ -357,6 +378,7 @@ class Effect {
   void SetVolume(uint8_t v) { volume_ = v; }
   uint8_t GetVolume() const { return volume_; }
   const char* GetName() const { return name_; }
+  Priority GetPriority() const { return priority_; }
 
   // Returns true if file was identified.
   static void ScanAll(const char *dir, const char* filename) {
@@ -380,8 +402,23 @@ class Effect {
     }
   }
 
+  // Incremented every time files are re-scanned, FileIDs from
+  // earlier generations may refer to other files.
+  static uint32_t generation() { return generation_; }
+
   static void ScanCurrentDirectory() {
     LOCK_SD(true);
+    generation_++;
+
+#if defined(ENABLE_SD) && !defined(DISABLE_FONT_INDEX)
+    // Make sure each directory has an up-to-date index first.
+    // Indexes are made for one directory at a time, so this
+    // may clobber the state of all effects.
+    for (const char* dir = current_directory; dir; dir = next_current_directory(dir)) {
+      if (LSFS::Exists(dir)) UpdateIndex(dir);
+    }
+#endif
+
     for (Effect* e = all_effects; e; e = e->next_) {
       e->reset();
     }
@@ -405,20 +442,12 @@ class Effect {
 
 #ifdef ENABLE_SD
       if (LSFS::Exists(dir)) {
-        for (LSFS::Iterator iter(dir); iter; ++iter) {
-          if (iter.isdir()) {
-            char fname[128];
-            strcpy(fname, iter.name());
-            strcat(fname, "/");
-            char* fend = fname + strlen(fname);
-            for (LSFS::Iterator i2(iter); i2; ++i2) {
-              strcpy(fend, i2.name());
-              ScanAll(dir, fname);
-            }
-          } else {
-            ScanAll(dir, iter.name());
-          }
-        }
+#ifndef DISABLE_FONT_INDEX
+        if (ReadIndex(dir)) {
+	  STDOUT.print(" (indexed)");
+	} else
+#endif
+        ScanDirectory(dir);
 	STDOUT.println(" done");
       } else {
 	STDOUT.println(" NOT FOUND!");
@@ -454,8 +483,211 @@ class Effect {
     LOCK_SD(false);
   }
 
+#if defined(ENABLE_SD) && !defined(DISABLE_FONT_INDEX)
+  // Removes the index files in the current font directories, forcing
+  // a full scan the next time the font is loaded. Needed if files are
+  // added or removed inside the subdirectories of a font.
+  static void RemoveIndexes() {
+    LOCK_SD(true);
+    for (const char* dir = current_directory; dir; dir = next_current_directory(dir)) {
+      PathHelper filename(dir, FONT_INDEX_FILENAME);
+      LSFS::Remove(filename);
+    }
+    LOCK_SD(false);
+  }
+#endif
+
   Effect* next_;
 private:
+#ifdef ENABLE_SD
+  static void ScanDirectory(const char* dir) {
+    for (LSFS::Iterator iter(dir); iter; ++iter) {
+      if (iter.isdir()) {
+        char fname[128];
+        strcpy(fname, iter.name());
+        strcat(fname, "/");
+        char* fend = fname + strlen(fname);
+        for (LSFS::Iterator i2(iter); i2; ++i2) {
+          strcpy(fend, i2.name());
+          ScanAll(dir, fname);
+        }
+      } else {
+        ScanAll(dir, iter.name());
+      }
+    }
+  }
+
+#ifndef DISABLE_FONT_INDEX
+  // The font index is a small binary file in each font directory which
+  // holds the result of ScanDirectory(), so that we don't have to look
+  // at every file every time a font is loaded. It is validated with a
+  // signature of the names of all effects and the names and sizes of
+  // the files in the directory and its subdirectories, as far down as
+  // ScanDirectory() looks.
+  struct IndexHeader {
+    uint32_t magic;
+    uint32_t signature;
+    uint16_t entries;
+    uint16_t reserved;
+  };
+
+  struct IndexEntry {
+    // Position of the effect in the all_effects list.
+    uint8_t effect;
+    int8_t digits;
+    uint8_t ext;
+    // Bit 0-1: file pattern, bit 2: unnumbered file found.
+    uint8_t flags;
+    int16_t min_file;
+    int16_t max_file;
+    int16_t num_files;
+  };
+
+  static const uint32_t kIndexMagic = 0x31584449;  // "IDX1"
+
+  static uint32_t HashBytes(uint32_t h, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) h = (h ^ p[i]) * 16777619;
+    return h;
+  }
+
+  static uint32_t HashString(uint32_t h, const char* str) {
+    return HashBytes(h, str, strlen(str) + 1);
+  }
+
+  static uint32_t IndexSignature(const char* dir) {
+    uint32_t h = 2166136261U;
+    for (Effect* e = all_effects; e; e = e->next_) {
+      h = HashString(h, e->name_);
+      h = HashBytes(h, &e->file_type_, sizeof(e->file_type_));
+    }
+    for (LSFS::Iterator iter(dir); iter; ++iter) {
+      if (!strcmp(iter.name(), FONT_INDEX_FILENAME)) continue;
+      uint32_t size = iter.isdir() ? 0xFFFFFFFFU : iter.size();
+      h = HashString(h, iter.name());
+      h = HashBytes(h, &size, sizeof(size));
+      if (iter.isdir()) {
+        for (LSFS::Iterator i2(iter); i2; ++i2) {
+          size = i2.isdir() ? 0xFFFFFFFFU : i2.size();
+          h = HashString(h, i2.name());
+          h = HashBytes(h, &size, sizeof(size));
+        }
+        // End of the subdirectory.
+        h = HashBytes(h, "", 1);
+      }
+    }
+    return h;
+  }
+
+  static bool ReadIndexHeader(FileReader* f, const char* dir, IndexHeader* header) {
+    PathHelper filename(dir, FONT_INDEX_FILENAME);
+    if (!f->OpenFast(filename)) return false;
+    if (f->Read((uint8_t*)header, sizeof(*header)) != sizeof(*header) ||
+        header->magic != kIndexMagic ||
+        f->FileSize() != sizeof(*header) + header->entries * sizeof(IndexEntry)) {
+      f->Close();
+      return false;
+    }
+    return true;
+  }
+
+  // Scans |dir| by itself and writes a new index file, unless
+  // the existing one is still valid.
+  static void UpdateIndex(const char* dir) {
+    uint32_t signature = IndexSignature(dir);
+    FileReader f;
+    IndexHeader header;
+    if (ReadIndexHeader(&f, dir, &header)) {
+      f.Close();
+      if (header.signature == signature) return;
+    }
+
+    for (Effect* e = all_effects; e; e = e->next_) {
+      e->reset();
+    }
+    ScanDirectory(dir);
+
+    header.magic = kIndexMagic;
+    header.signature = signature;
+    header.entries = 0;
+    header.reserved = 0;
+    for (Effect* e = all_effects; e; e = e->next_) {
+      if (e->directory_ == dir) header.entries++;
+    }
+
+    PathHelper filename(dir, FONT_INDEX_FILENAME);
+    LSFS::Remove(filename);
+    if (!f.Create(filename)) return;
+    bool ok = f.Write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+    int pos = 0;
+    for (Effect* e = all_effects; e && ok; e = e->next_, pos++) {
+      if (e->directory_ != dir) continue;
+      IndexEntry entry;
+      entry.effect = pos;
+      entry.digits = e->digits_;
+      entry.ext = e->ext_;
+      entry.flags = (uint8_t)e->file_pattern_ | (e->unnumbered_file_found_ ? 4 : 0);
+      entry.min_file = e->min_file_;
+      entry.max_file = e->max_file_;
+      entry.num_files = e->num_files_;
+      ok = f.Write((const uint8_t*)&entry, sizeof(entry)) == sizeof(entry);
+    }
+    f.Close();
+    // Don't leave a partial index behind.
+    if (!ok) LSFS::Remove(filename);
+  }
+
+  // Loads the scan results for |dir| from its index file.
+  // Effects already found in an earlier directory are left alone.
+  static bool ReadIndex(const char* dir) {
+    FileReader f;
+    IndexHeader header;
+    if (!ReadIndexHeader(&f, dir, &header)) return false;
+    Effect* e = all_effects;
+    int pos = 0;
+    for (int i = 0; i < header.entries; i++) {
+      IndexEntry entry;
+      if (f.Read((uint8_t*)&entry, sizeof(entry)) != sizeof(entry)) break;
+      while (e && pos < entry.effect) {
+        e = e->next_;
+        pos++;
+      }
+      if (!e) break;
+      if (e->directory_) continue;
+      e->directory_ = dir;
+      e->digits_ = entry.digits;
+      e->ext_ = (Extension)entry.ext;
+      e->file_pattern_ = (FilePattern)(entry.flags & 3);
+      e->unnumbered_file_found_ = !!(entry.flags & 4);
+      e->min_file_ = entry.min_file;
+      e->max_file_ = entry.max_file;
+      e->num_files_ = entry.num_files;
+    }
+    f.Close();
+    return true;
+  }
+#endif  // DISABLE_FONT_INDEX
+#endif  // ENABLE_SD
+
+  int PickRandom(int num_files) {
+    int n = rand() % num_files;
+#ifdef NO_REPEAT_RANDOM
+    switch (num_files) {
+    default:
+      while (n == last_) n = rand() % num_files;
+      break;
+    case 2:
+      if (n == last_) n = rand() % num_files;
+    case 1:
+      break;
+    }
+    last_ = n;
+#endif
+    return n;
+  }
+
+  static uint32_t generation_;
+
   Effect* following_ = nullptr;
 
   // Minimum file number.
@@ -489,19 +721,27 @@ private:
   // If not -1, return this file.
   int16_t selected_;
 
+  // If not -1, the next random file, picked early by PeekRandomFile().
+  int16_t next_random_;
+
   // All files must end with this extension.
   Extension ext_;
 
   // Image or sound?
   FileType file_type_;
 
+  Priority priority_;
+
   // The files for this effect are in this directory.
   const char* directory_;
 };
 
 
+uint32_t Effect::generation_ = 0;
+
 #define EFFECT(X) Effect SFX_##X(#X)
 #define EFFECT2(X, Y) Effect SFX_##X(#X, &SFX_##Y)
+#define EFFECT_PRIORITY(X, P) Effect SFX_##X(#X, nullptr, Effect::FileType::SOUND, Effect::Priority::P)
 #define IMAGE_FILESET(X) Effect IMG_##X(#X, nullptr, Effect::FileType::IMAGE)
 
 EFFECT(preon);
@@ -513,7 +753,7 @@ EFFECT(bladein);  // also polyphonic
 EFFECT(bladeout);  // also polyphonic
 EFFECT2(hum, hum);
 EFFECT2(humm, humm);
-EFFECT(swing);
+EFFECT_PRIORITY(swing, SWING);
 EFFECT(poweron);
 EFFECT2(poweroff, pstoff);
 EFFECT2(pwroff, pstoff);
@@ -521,9 +761,9 @@ EFFECT(clash);
 EFFECT(force);    // also polyphonic
 EFFECT(stab);     // also polyphonic
 #ifdef ENABLE_SPINS
-EFFECT(spin);     // also polyphonic
+EFFECT_PRIORITY(spin, SWING);     // also polyphonic
 #endif
-EFFECT(blaster);
+EFFECT_PRIORITY(blaster, BLAST);
 EFFECT2(lockup, lockup);
 EFFECT(poweronf); // force poweron
 EFFECT(font);     // also polyphonic
@@ -531,13 +771,13 @@ EFFECT(bgnlock);  // monophonic and polyphonic begin lock
 EFFECT(endlock);  // Plecter endlock support, used for polyphonic name too
 
 // Polyphonic fonts
-EFFECT(blst);
+EFFECT_PRIORITY(blst, BLAST);
 EFFECT(clsh);
 EFFECT2(in, pstoff);
 EFFECT(out);
 EFFECT2(lock, lock);
-EFFECT(swng);
-EFFECT(slsh);
+EFFECT_PRIORITY(swng, SWING);
+EFFECT_PRIORITY(slsh, SWING);
 
 // Looped swing fonts. (SmoothSwing V1/V2)
 EFFECT2(swingl, swingl);  // Looped swing, LOW
@@ -568,10 +808,10 @@ EFFECT(endarm);
 EFFECT(boom);
 
 // Color change
-EFFECT(color);
-EFFECT(ccbegin);
-EFFECT(ccend);
-EFFECT(ccchange);
+EFFECT_PRIORITY(color, MENU);
+EFFECT_PRIORITY(ccbegin, MENU);
+EFFECT_PRIORITY(ccend, MENU);
+EFFECT_PRIORITY(ccchange, MENU);
 
 // Blaster effects
 // hum, boot and font are reused from sabers and already defined.
@@ -579,7 +819,7 @@ EFFECT(bgnauto); // Doesn't exist in fonts, but I expect there may be use for au
 EFFECT2(auto,auto);
 EFFECT(endauto); // Doesn't exist in fonts, but I expect there may be use for autofire transitions
 
-EFFECT(blast); // Not to be confused with "blst" and "blaster" as blocking sounds in sabers
+EFFECT_PRIORITY(blast, BLAST); // Not to be confused with "blst" and "blaster" as blocking sounds in sabers
 
 // battery low
 EFFECT(lowbatt);	// battery low
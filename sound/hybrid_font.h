@@ -163,6 +163,17 @@ public:
     }
 
     STDOUT.println(" font.");
+    // Clashes and blasts are the most latency-sensitive effects,
+    // have them ready to go before they happen.
+    wav_file_cache.Prefetch(&SFX_clash);
+    wav_file_cache.Prefetch(&SFX_blst);
+    // If there is a RAM cache, keep them in memory, most important first.
+    ClearWavRamCache();
+    wav_ram_cache.Add(&SFX_clash);
+    wav_ram_cache.Add(&SFX_clsh);
+    wav_ram_cache.Add(&SFX_blst);
+    wav_ram_cache.Add(&SFX_blaster);
+    wav_ram_cache.Add(&SFX_stab);
     SaberBase::Link(this);
     Looper::Link();
     SetHumVolume(1.0);
@@ -207,7 +218,7 @@ public:
   void PlayMonophonic(Effect* f, Effect* loop)  {
     EnableAmplifier();
     if (!next_hum_player_) {
-      next_hum_player_ = GetFreeWavPlayer();
+      next_hum_player_ = GetFreeWavPlayer(Effect::Priority::LOOP);
       if (!next_hum_player_) {
         STDOUT.println("Out of WAV players!");
         return;
@@ -233,7 +244,7 @@ public:
   RefPtr<BufferedWavPlayer> PlayPolyphonic(Effect* f)  {
     EnableAmplifier();
     if (!f->files_found()) return RefPtr<BufferedWavPlayer>(nullptr);
-    RefPtr<BufferedWavPlayer> player = GetFreeWavPlayer();
+    RefPtr<BufferedWavPlayer> player = GetFreeWavPlayer(f->GetPriority());
     if (player) {
       player->set_volume_now(font_config.volEff / 16.0f);
       player->PlayOnce(f);
@@ -401,7 +412,7 @@ public:
     } else {
       state_ = STATE_OUT;
       if (!hum_player_) {
-	hum_player_ = GetFreeWavPlayer();
+	hum_player_ = GetFreeWavPlayer(Effect::Priority::LOOP);
 	if (hum_player_) {
 	  hum_player_->set_volume_now(0);
 	  hum_player_->PlayOnce(SFX_humm ? &SFX_humm : &SFX_hum);
@@ -642,7 +653,7 @@ public:
   void SetHumVolume(float vol) override {
     if (!monophonic_hum_) {
       if (active_state() && !hum_player_) {
-        hum_player_ = GetFreeWavPlayer();
+        hum_player_ = GetFreeWavPlayer(Effect::Priority::LOOP);
         if (hum_player_) {
           hum_player_->set_volume_now(0);
           hum_player_->PlayOnce(SFX_humm ? &SFX_humm : &SFX_hum);
@@ -0,0 +1,90 @@
+#ifndef SOUND_IMA_ADPCM_H
+#define SOUND_IMA_ADPCM_H
+
+// IMA ADPCM, as used in wav files with format tag 0x11.
+// Each 4-bit code is decoded with a couple of adds and shifts, so
+// decoding is cheaper than reading the 16-bit samples from SD.
+//
+// Data is stored in blocks of "block align" bytes. Each block starts
+// with a four byte header per channel: the first sample (int16) and
+// the step index (uint8), followed by one unused byte. After that,
+// the channels are interleaved four bytes (eight samples) at a time,
+// low nibble first.
+
+#define IMA_ADPCM_FORMAT 0x11
+
+static const int16_t ima_adpcm_step_table[89] = {
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+  19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+  50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+  130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+  337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+  876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+  2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+  5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+  15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t ima_adpcm_index_table[16] = {
+  -1, -1, -1, -1, 2, 4, 6, 8,
+  -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+class IMAADPCMChannel {
+public:
+  // Reads the four byte block header, returns the first sample.
+  int16_t Start(const unsigned char* header) {
+    predictor_ = (int16_t)(header[0] | (header[1] << 8));
+    index_ = header[2];
+    if (index_ > 88) index_ = 88;
+    return predictor_;
+  }
+
+  int16_t Decode(int code) {
+    int step = ima_adpcm_step_table[index_];
+    int diff = step >> 3;
+    if (code & 4) diff += step;
+    if (code & 2) diff += step >> 1;
+    if (code & 1) diff += step >> 2;
+    if (code & 8) diff = -diff;
+    predictor_ = clamptoi16(predictor_ + diff);
+    index_ += ima_adpcm_index_table[code];
+    if (index_ < 0) index_ = 0;
+    if (index_ > 88) index_ = 88;
+    return predictor_;
+  }
+
+  // Returns the code that gets the decoder closest to |sample|,
+  // and updates the state the same way Decode() does.
+  int Encode(int16_t sample) {
+    int step = ima_adpcm_step_table[index_];
+    int diff = sample - predictor_;
+    int code = 0;
+    if (diff < 0) {
+      code = 8;
+      diff = -diff;
+    }
+    if (diff >= step) { code |= 4; diff -= step; }
+    step >>= 1;
+    if (diff >= step) { code |= 2; diff -= step; }
+    step >>= 1;
+    if (diff >= step) code |= 1;
+    Decode(code);
+    return code;
+  }
+
+  // Writes a block header for the current state, used by the encoder.
+  void WriteHeader(unsigned char* header, int16_t first_sample) {
+    predictor_ = first_sample;
+    header[0] = first_sample & 0xff;
+    header[1] = ((uint16_t)first_sample) >> 8;
+    header[2] = index_;
+    header[3] = 0;
+  }
+
+private:
+  int16_t predictor_ = 0;
+  int index_ = 0;
+};
+
+#endif
@@ -0,0 +1,91 @@
+// Generates resampler_tables.h, the coefficient tables used by
+// PolyphaseResampler in resampler.h.
+// Usage: ./make_resampler_tables >resampler_tables.h
+//
+// Each table is a kaiser-windowed sinc sampled at RESAMPLER_PHASES + 1
+// fractional offsets. Every row is normalized to unity DC gain so that
+// interpolating between rows does not modulate the volume.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RESAMPLER_TAPS 24
+#define RESAMPLER_PHASES 32
+#define RESAMPLER_COEFF_BITS 14
+
+double I0(double x) {
+  double sum = 1.0, term = 1.0;
+  for (int k = 1; k < 50; k++) {
+    term *= (x / (2 * k)) * (x / (2 * k));
+    sum += term;
+  }
+  return sum;
+}
+
+double Kaiser(double x, double beta) {
+  // x in [-1, 1]
+  if (x <= -1.0 || x >= 1.0) return 0.0;
+  return I0(beta * sqrt(1.0 - x * x)) / I0(beta);
+}
+
+double Sinc(double x) {
+  if (fabs(x) < 1e-12) return 1.0;
+  return sin(M_PI * x) / (M_PI * x);
+}
+
+// |cutoff| is in cycles per input sample.
+void MakeTable(const char* name, const char* comment,
+               double cutoff, double beta) {
+  printf("// %s\n", comment);
+  printf("static const int16_t %s[RESAMPLER_PHASES + 1][RESAMPLER_TAPS]"
+         " __attribute__((aligned(4))) = {\n", name);
+  const double half = RESAMPLER_TAPS / 2.0;
+  for (int phase = 0; phase <= RESAMPLER_PHASES; phase++) {
+    double frac = phase / (double)RESAMPLER_PHASES;
+    // Output position, relative to the oldest sample in the window.
+    double center = RESAMPLER_TAPS / 2 - 1 + frac;
+    double coeffs[RESAMPLER_TAPS];
+    double sum = 0.0;
+    for (int k = 0; k < RESAMPLER_TAPS; k++) {
+      double t = k - center;
+      coeffs[k] = 2 * cutoff * Sinc(2 * cutoff * t) * Kaiser(t / half, beta);
+      sum += coeffs[k];
+    }
+    int icoeffs[RESAMPLER_TAPS];
+    int isum = 0;
+    int biggest = 0;
+    for (int k = 0; k < RESAMPLER_TAPS; k++) {
+      icoeffs[k] = lrint(coeffs[k] / sum * (1 << RESAMPLER_COEFF_BITS));
+      isum += icoeffs[k];
+      if (abs(icoeffs[k]) > abs(icoeffs[biggest])) biggest = k;
+    }
+    // Put the rounding error on the largest tap to get exact unity gain.
+    icoeffs[biggest] += (1 << RESAMPLER_COEFF_BITS) - isum;
+    printf("  {");
+    for (int k = 0; k < RESAMPLER_TAPS; k++) {
+      printf("%s%d", k ? "," : "", icoeffs[k]);
+    }
+    printf("},\n");
+  }
+  printf("};\n\n");
+}
+
+int main() {
+  printf("// Generated by make_resampler_tables.cpp, do not edit.\n");
+  printf("#ifndef SOUND_RESAMPLER_TABLES_H\n");
+  printf("#define SOUND_RESAMPLER_TABLES_H\n\n");
+  printf("#define RESAMPLER_TAPS %d\n", RESAMPLER_TAPS);
+  printf("#define RESAMPLER_PHASES %d\n", RESAMPLER_PHASES);
+  printf("#define RESAMPLER_COEFF_BITS %d\n\n", RESAMPLER_COEFF_BITS);
+  MakeTable("resampler_up_taps",
+            "Upsampling, cutoff just below the input nyquist frequency.",
+            0.45, 6.0);
+  MakeTable("resampler_down1_taps",
+            "Downsampling from up to 50kHz, cutoff below 22kHz.",
+            0.40 * 44100.0 / 50000.0, 6.0);
+  MakeTable("resampler_down2_taps",
+            "Downsampling from up to 100kHz, cutoff below 20kHz.",
+            0.40 * 44100.0 / 100000.0, 6.0);
+  printf("#endif\n");
+}
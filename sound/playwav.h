@@ -4,61 +4,18 @@
 #include "../common/file_reader.h"
 #include "../common/state_machine.h"
 #include "audiostream.h"
-
-// Simple upsampler code, doubles the number of samples with
-// 2-lobe lanczos upsampling.
-#define UPSCALE_C1 24757
-#define UPSCALE_C2 -8191
-
-#if 1
-#define UPSAMPLE_FUNC(NAME, EMIT)                               \
-  void NAME(int16_t sample) {                                   \
-    upsample_buf_##NAME##_a_ = upsample_buf_##NAME##_b_;        \
-    upsample_buf_##NAME##_b_ = upsample_buf_##NAME##_c_;        \
-    upsample_buf_##NAME##_c_ = upsample_buf_##NAME##_d_;        \
-    upsample_buf_##NAME##_d_ = sample;                          \
-    EMIT(clamptoi16((upsample_buf_##NAME##_a_ * UPSCALE_C2 +            \
-          upsample_buf_##NAME##_b_ * UPSCALE_C1 +                       \
-          upsample_buf_##NAME##_c_ * UPSCALE_C1 +                       \
-                   upsample_buf_##NAME##_d_ * UPSCALE_C2) >> 15));      \
-    EMIT(upsample_buf_##NAME##_c_);                             \
-  }                                                             \
-  void clear_##NAME() {                                         \
-    upsample_buf_##NAME##_a_ = 0;                               \
-    upsample_buf_##NAME##_b_ = 0;                               \
-    upsample_buf_##NAME##_c_ = 0;                               \
-    upsample_buf_##NAME##_d_ = 0;                               \
-  }                                                             \
-  int16_t upsample_buf_##NAME##_a_ = 0;                         \
-  int16_t upsample_buf_##NAME##_b_ = 0;                         \
-  int16_t upsample_buf_##NAME##_c_ = 0;                         \
-  int16_t upsample_buf_##NAME##_d_ = 0
-#else
-#define UPSAMPLE_FUNC(NAME, EMIT)               \
-  void NAME(int16_t sample) {                   \
-      EMIT(sample);      EMIT(sample);          \
-  }                                             \
-  void clear_##NAME() {                         \
-  }
+#include "resampler.h"
+#include "ima_adpcm.h"
+#include "wav_file_cache.h"
+#include "wav_ram_cache.h"
+
+// Number of SD blocks that PlayWav reads at a time. Reading more than
+// one block at a time means fewer, larger SD transfers, but costs
+// 512 bytes of memory per block for each wav player.
+#ifndef PLAYWAV_READ_BLOCKS
+#define PLAYWAV_READ_BLOCKS 2
 #endif
 
-#define DOWNSAMPLE_FUNC(NAME, EMIT)                     \
-  void NAME(int16_t sample) {                           \
-    if (downsample_flag_##NAME##_) {                    \
-      EMIT((downsample_buf_##NAME##_ + sample) >> 1);   \
-      downsample_flag_##NAME##_ = false;                \
-    } else {                                            \
-      downsample_buf_##NAME##_ = sample;                \
-      downsample_flag_##NAME##_ = true;                 \
-    }                                                   \
-  }                                                     \
-  void clear_##NAME() {                                 \
-    downsample_buf_##NAME##_ = 0;                       \
-    downsample_flag_##NAME##_ = false;                  \
-  }                                                     \
-  int16_t downsample_buf_##NAME##_ = 0;                 \
-  bool downsample_flag_##NAME##_ = false
-
 // PlayWav reads a file from serialflash or SD and converts
 // it into a stream of samples. Note that because it can
 // spend some time reading data between samples, the
@@ -79,6 +36,8 @@ public:
   void PlayOnce(Effect* effect, float start = 0.0) {
     sample_bytes_ = 0;
     new_file_id_ = effect->RandomFile();
+    // Open the file that will be played next time ahead of time.
+    wav_file_cache.Prefetch(effect);
     if (new_file_id_) {
       new_file_id_.GetName(filename_);
       start_ = start;
@@ -97,6 +56,7 @@ public:
     state_machine_.reset_state_machine();
     effect_ = nullptr;
     written_ = num_samples_ = 0;
+    resampler_.clear();
     interrupts();
   }
 
@@ -112,6 +72,12 @@ private:
   UPSAMPLE_FUNC(Emit4, Emit2);
   DOWNSAMPLE_FUNC(Emit05, Emit1);
 
+  // Used for all rates that Emit2/Emit4/Emit05 cannot handle.
+  void EmitResampled(int16_t sample) {
+    resampler_.Push(sample);
+    while (resampler_.Ready()) Emit1(resampler_.Next());
+  }
+
   uint32_t header(int n) const {
     return ((uint32_t *)buffer)[n+2];
   }
@@ -133,19 +99,62 @@ private:
     effect_ = nullptr;
   }
 
+  // Number of bytes that DecodeBytes() consumes at a time.
+  int FrameBytes() const {
+    if (info_.bits == 4) return 4 * info_.channels;  // IMA ADPCM
+    return info_.channels * info_.bits / 8;
+  }
+
+  // A rate of zero means that the polyphase resampler is used.
+  template<int rate>
+  static constexpr int MaxOutputs() {
+    return rate == 0 ? PolyphaseResampler::kMaxOutputsPerInput :
+      rate < AUDIO_RATE ? AUDIO_RATE / rate : 1;
+  }
+
+  // Decodes one sample frame of IMA ADPCM data, the frame is
+  // only consumed once all eight samples have been decoded.
+  template<int channels>
+  int ReadADPCM() {
+    int v;
+    if (block_left_ == 0) {
+      v = adpcm_[0].Start(ptr_);
+      if (channels == 2) v += adpcm_[1].Start(ptr_ + 4);
+      ptr_ += 4 * channels;
+      block_left_ = info_.block_align - 4 * channels;
+    } else {
+      int shift = (adpcm_nibble_ & 1) * 4;
+      v = adpcm_[0].Decode((ptr_[adpcm_nibble_ >> 1] >> shift) & 0xf);
+      if (channels == 2)
+        v += adpcm_[1].Decode((ptr_[4 + (adpcm_nibble_ >> 1)] >> shift) & 0xf);
+      if (++adpcm_nibble_ == 8) {
+        adpcm_nibble_ = 0;
+        ptr_ += 4 * channels;
+        block_left_ -= 4 * channels;
+      }
+    }
+    if (channels == 2) v >>= 1;
+    return v;
+  }
+
   template<int bits, int channels, int rate>
   void DecodeBytes4() {
-    while (ptr_ < end_ - channels * bits / 8 &&
-           num_samples_ < (int)NELEM(samples_)) {
+    const int frame_bytes = bits == 4 ? 4 * channels : channels * bits / 8;
+    while (ptr_ + frame_bytes <= end_ &&
+           num_samples_ <= (int)NELEM(samples_) - MaxOutputs<rate>()) {
       int v = 0;
-      if (channels == 1) {
+      if (bits == 4) {
+        v = ReadADPCM<channels>();
+      } else if (channels == 1) {
         v = read2<bits>();
       } else {
         v = read2<bits>();
         v += read2<bits>();
         v >>= 1;
       }
-      if (rate == AUDIO_RATE) {
+      if (rate == 0) {
+        EmitResampled(v);
+      } else if (rate == AUDIO_RATE) {
         Emit1(v);
       } else if (rate == AUDIO_RATE / 2) {
         Emit2(v);
@@ -161,28 +170,34 @@ private:
 
   template<int bits, int channels>
   void DecodeBytes3() {
-    if (rate_ == 44100)
+    if (info_.rate == 44100)
       DecodeBytes4<bits, channels, 44100>();
-    else if (rate_ == 22050)
+#ifndef POLYPHASE_RESAMPLE_ALL_RATES
+    else if (info_.rate == 22050)
       DecodeBytes4<bits, channels, 22050>();
-    else if (rate_ == 11025)
+    else if (info_.rate == 11025)
       DecodeBytes4<bits, channels, 11025>();
+#endif
+    else if (resampling_)
+      DecodeBytes4<bits, channels, 0>();
     else
       AbortDecodeBytes("Unsupported rate.");
   }
 
   template<int bits>
   void DecodeBytes2() {
-    if (channels_ == 1) DecodeBytes3<bits, 1>();
-    else if (channels_ == 2) DecodeBytes3<bits, 2>();
+    if (info_.channels == 1) DecodeBytes3<bits, 1>();
+    else if (info_.channels == 2) DecodeBytes3<bits, 2>();
     else AbortDecodeBytes("unsupported number of channels");
   }
 
   void DecodeBytes() {
-    if (bits_ == 8) DecodeBytes2<8>();
-    else if (bits_ == 16) DecodeBytes2<16>();
-//    else if (bits_ == 24) DecodeBytes2<24>();
-//    else if (bits_ == 32) DecodeBytes2<32>();
+    SCOPED_PROFILER();
+    if (info_.bits == 4) DecodeBytes2<4>();
+    else if (info_.bits == 8) DecodeBytes2<8>();
+    else if (info_.bits == 16) DecodeBytes2<16>();
+//    else if (info_.bits == 24) DecodeBytes2<24>();
+//    else if (info_.bits == 32) DecodeBytes2<32>();
     else AbortDecodeBytes("Unsupported sample size.");
   }
 
@@ -191,6 +206,29 @@ private:
     return file_.Read(buffer + 8, n);
   }
 
+  // Reads samples straight into dest_, skipping |buffer| and
+  // DecodeBytes(). Only used when the data is already in the output
+  // format. AlignRead() keeps the reads on SD block boundaries, so
+  // whole blocks are transferred directly into the destination and
+  // only the end of a block goes through the file system's block cache.
+  // Returns false if the regular path should be used instead.
+  bool ReadDirect() {
+    SCOPED_PROFILER();
+    if (ptr_ != buffer + 8) return false;
+    int n = file_.AlignRead(std::min<size_t>(len_, to_read_ * 2)) & ~1;
+    if (n <= 0) return false;
+    int bytes_read = file_.Read((uint8_t*)dest_, n);
+    if (bytes_read <= 0) {
+      len_ = 0;
+      return true;
+    }
+    len_ -= bytes_read;
+    end_ = ptr_;
+    dest_ += bytes_read / 2;
+    to_read_ -= bytes_read / 2;
+    return true;
+  }
+
   void loop() {
     STATE_MACHINE_BEGIN();
     while (true) {
@@ -202,11 +240,31 @@ private:
         run_ = true;
 	effect_ = effect_->GetFollowing();
       }
+      if (from_ram_ && !(new_file_id_ && new_file_id_ == old_file_id_)) {
+        // Nothing to keep open for files in RAM.
+        file_.Close();
+        old_file_id_ = Effect::FileID();
+        from_ram_ = false;
+      }
       if (new_file_id_ && new_file_id_ == old_file_id_) {
         // Minor optimization: If we're reading the same file
-        // as before, then seek to 0 instead of open/close file.
-        file_.Rewind();
+        // as before, then seek to the data instead of open/close file.
+        file_.Seek(info_.data_offset);
+      } else if (wav_ram_cache.Contains(new_file_id_)) {
+        // Loaded when the font was activated, no SD access at all.
+        wav_file_cache.Give(old_file_id_, &file_, info_);
+        wav_ram_cache.Open(new_file_id_, &file_, &info_);
+        old_file_id_ = new_file_id_;
+        from_ram_ = true;
+      } else if (wav_file_cache.Exchange(new_file_id_, old_file_id_,
+                                         &file_, &info_)) {
+        // The file was already open and positioned at the data.
+        old_file_id_ = new_file_id_;
       } else {
+        if (new_file_id_) wav_file_cache.CountMiss();
+        // Keep the previous file open, it might get played again soon.
+        wav_file_cache.Give(old_file_id_, &file_, info_);
+        old_file_id_ = Effect::FileID();
 	if (!file_.OpenFast(filename_)) {
 	  default_output->print("File ");
 	  default_output->print(filename_);
@@ -214,68 +272,32 @@ private:
 	  goto fail;
 	}
 	YIELD();
+        if (!ReadWavHeader(&file_, filename_, &info_)) goto fail;
         old_file_id_ = new_file_id_;
       }
-      wav_ = endswith(".wav", filename_);
-      if (wav_) {
-        if (ReadFile(12) != 12) {
-          default_output->println("Failed to read 12 bytes.");
-          goto fail;
-        }
-        if (header(0) != 0x46464952 || header(2) != 0x45564157) {
-          default_output->println("Not RIFF WAVE.");
-          YIELD();
-          goto fail;
-        }
-
-        // Look for FMT header.
-        while (true) {
-          if (ReadFile(8) != 8) {
-            default_output->println("Failed to read 8 bytes.");
-            goto fail;
-          }
-
-          len_ = header(1);
-          if (header(0) != 0x20746D66) {  // 'fmt '
-            file_.Skip(len_);
-            continue;
-          }
-          if (len_ < 16) {
-            default_output->println("FMT header is wrong size..");
-            goto fail;
-          }
-          break;
-        }
-        
-        if (16 != ReadFile(16)) {
-          default_output->println("Read failed.");
-          goto fail;
-        }
-        if (len_ > 16) file_.Skip(len_ - 16);
-        if ((header(0) & 0xffff) != 1) {
-          default_output->println("Wrong format.");
-          goto fail;
-        }
-        channels_ = header(0) >> 16;
-        rate_ = header(1);
-        bits_ = header(3) >> 16;
-      } else {
-         channels_ = 1;
-         rate_ = 44100;
-         bits_ = 16;
-      }
+      // The resampler keeps its history if the rate doesn't change, so
+      // that looped sounds stay seamless.
+      resampling_ = info_.rate != AUDIO_RATE && resampler_.Setup(info_.rate, AUDIO_RATE);
+      // 16-bit mono at the output rate needs no decoding at all.
+      direct_ = info_.bits == 16 && info_.channels == 1 && info_.rate == AUDIO_RATE;
       default_output->print("channels: ");
-      default_output->print(channels_);
+      default_output->print(info_.channels);
       default_output->print(" rate: ");
-      default_output->print(rate_);
+      default_output->print(info_.rate);
       default_output->print(" bits: ");
-      default_output->println(bits_);
+      default_output->println(info_.bits);
 
       ptr_ = buffer + 8;
       end_ = buffer + 8;
+      block_left_ = 0;
+      adpcm_nibble_ = 0;
       
+      first_chunk_ = true;
       while (true) {
-        if (wav_) {
+        if (first_chunk_) {
+          first_chunk_ = false;
+          len_ = info_.data_len;
+        } else if (info_.wav) {
           if (ReadFile(8) != 8) break;
           len_ = header(1);
           if (header(0) != 0x61746164) {
@@ -289,22 +311,28 @@ private:
         sample_bytes_ = len_;
 
         if (start_ != 0.0) {
-          int samples = Fmod(start_, length()) * rate_;
-          int bytes_to_skip = samples * channels_ * bits_ / 8;
+          int samples = Fmod(start_, length()) * info_.rate;
+          int bytes_to_skip = samples * info_.channels * info_.bits / 8;
+          // ADPCM can only start at a block boundary.
+          if (info_.bits == 4) bytes_to_skip -= bytes_to_skip % info_.block_align;
           file_.Skip(bytes_to_skip);
           len_ -= bytes_to_skip;
           start_ = 0.0;
         }
 
         while (len_) {
+          if (direct_) {
+            while (to_read_ == 0) YIELD();
+            if (ReadDirect()) continue;
+          }
           {
-            int bytes_read = ReadFile(file_.AlignRead(std::min<size_t>(len_, 512u)));
+            int bytes_read = ReadFile(file_.AlignRead(std::min<size_t>(len_, PLAYWAV_READ_BLOCKS * 512u)));
             if (bytes_read <= 0)
               break;
             len_ -= bytes_read;
             end_ = buffer + 8 + bytes_read;
           }
-          while (ptr_ < end_ - channels_ * bits_ / 8) {
+          while (ptr_ + FrameBytes() <= end_) {
             DecodeBytes();
 
             while (written_ < num_samples_) {
@@ -357,17 +385,22 @@ public:
 
   // Length, seconds.
   float length() const {
-    return (float)(sample_bytes_) * 8 / (bits_ * rate_ * channels_);
+    if (info_.bits == 4) {
+      int samples_per_block = (info_.block_align - 4 * info_.channels) * 2 / info_.channels + 1;
+      return (float)(sample_bytes_) / info_.block_align * samples_per_block / info_.rate;
+    }
+    return (float)(sample_bytes_) * 8 / (info_.bits * info_.rate * info_.channels);
   }
 
   // Current position, seconds.
   float pos() const {
     if (!isPlaying()) return 0.0;
-    return (float)(sample_bytes_ - len_ + end_ - ptr_) * 8 / (bits_ * rate_);
+    return (float)(sample_bytes_ - len_ + end_ - ptr_) * 8 / (info_.bits * info_.rate);
   }
 
   void Close() {
     file_.Close();
+    from_ram_ = false;
     old_file_id_ = new_file_id_ = Effect::FileID();
   }
 
@@ -379,6 +412,8 @@ public:
     return new_file_id_;
   }
 
+  bool from_ram() const { return from_ram_; }
+
   void dump() {
     STDOUT << " run=" << run_
 	   << " filename=" << filename()
@@ -399,11 +434,19 @@ private:
   int tmp_;
   float start_ = 0.0;
 
-  int rate_;
-  uint8_t channels_;
-  uint8_t bits_;
+  WavInfo info_;
+
+  bool first_chunk_;
+  bool resampling_ = false;
+  bool direct_ = false;
+  // True if file_ is in wav_ram_cache.
+  bool from_ram_ = false;
+  PolyphaseResampler resampler_;
 
-  bool wav_;
+  // IMA ADPCM state
+  int block_left_ = 0;
+  int adpcm_nibble_ = 0;
+  IMAADPCMChannel adpcm_[2];
 
   FileReader file_;
 
@@ -411,7 +454,7 @@ private:
   volatile size_t sample_bytes_ = 0;
   unsigned char* ptr_;
   unsigned char* end_;
-  unsigned char buffer[512 + 8]  __attribute__((aligned(4)));
+  unsigned char buffer[PLAYWAV_READ_BLOCKS * 512 + 8]  __attribute__((aligned(4)));
 
   // Number of samples_ in samples that has been
   // sent out already.
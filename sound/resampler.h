@@ -0,0 +1,152 @@
+#ifndef SOUND_RESAMPLER_H
+#define SOUND_RESAMPLER_H
+
+#include "resampler_tables.h"
+
+// Simple upsampler code, doubles the number of samples with
+// 2-lobe lanczos upsampling.
+#define UPSCALE_C1 24757
+#define UPSCALE_C2 -8191
+
+#if 1
+#define UPSAMPLE_FUNC(NAME, EMIT)                               \
+  void NAME(int16_t sample) {                                   \
+    upsample_buf_##NAME##_a_ = upsample_buf_##NAME##_b_;        \
+    upsample_buf_##NAME##_b_ = upsample_buf_##NAME##_c_;        \
+    upsample_buf_##NAME##_c_ = upsample_buf_##NAME##_d_;        \
+    upsample_buf_##NAME##_d_ = sample;                          \
+    EMIT(clamptoi16((upsample_buf_##NAME##_a_ * UPSCALE_C2 +            \
+          upsample_buf_##NAME##_b_ * UPSCALE_C1 +                       \
+          upsample_buf_##NAME##_c_ * UPSCALE_C1 +                       \
+                   upsample_buf_##NAME##_d_ * UPSCALE_C2) >> 15));      \
+    EMIT(upsample_buf_##NAME##_c_);                             \
+  }                                                             \
+  void clear_##NAME() {                                         \
+    upsample_buf_##NAME##_a_ = 0;                               \
+    upsample_buf_##NAME##_b_ = 0;                               \
+    upsample_buf_##NAME##_c_ = 0;                               \
+    upsample_buf_##NAME##_d_ = 0;                               \
+  }                                                             \
+  int16_t upsample_buf_##NAME##_a_ = 0;                         \
+  int16_t upsample_buf_##NAME##_b_ = 0;                         \
+  int16_t upsample_buf_##NAME##_c_ = 0;                         \
+  int16_t upsample_buf_##NAME##_d_ = 0
+#else
+#define UPSAMPLE_FUNC(NAME, EMIT)               \
+  void NAME(int16_t sample) {                   \
+      EMIT(sample);      EMIT(sample);          \
+  }                                             \
+  void clear_##NAME() {                         \
+  }
+#endif
+
+#define DOWNSAMPLE_FUNC(NAME, EMIT)                     \
+  void NAME(int16_t sample) {                           \
+    if (downsample_flag_##NAME##_) {                    \
+      EMIT((downsample_buf_##NAME##_ + sample) >> 1);   \
+      downsample_flag_##NAME##_ = false;                \
+    } else {                                            \
+      downsample_buf_##NAME##_ = sample;                \
+      downsample_flag_##NAME##_ = true;                 \
+    }                                                   \
+  }                                                     \
+  void clear_##NAME() {                                 \
+    downsample_buf_##NAME##_ = 0;                       \
+    downsample_flag_##NAME##_ = false;                  \
+  }                                                     \
+  int16_t downsample_buf_##NAME##_ = 0;                 \
+  bool downsample_flag_##NAME##_ = false
+
+// Polyphase windowed-sinc resampler for arbitrary rate conversion.
+// Input samples are pushed one at a time, after each push the caller
+// drains all output samples that have become available:
+//
+//   resampler.Push(v);
+//   while (resampler.Ready()) Emit(resampler.Next());
+//
+// Output samples are computed from the two nearest filter phases
+// (see resampler_tables.h) and linearly interpolated between them.
+// The output is delayed by RESAMPLER_TAPS / 2 input samples.
+class PolyphaseResampler {
+public:
+  static const int kMinRate = 8000;
+  static const int kMaxRate = 100000;
+  // Most output samples that a single Push() can make available.
+  static const int kMaxOutputsPerInput = (AUDIO_RATE + kMinRate - 1) / kMinRate;
+
+  // Returns false if the conversion is not supported.
+  bool Setup(int in_rate, int out_rate) {
+    if (in_rate < kMinRate || in_rate > kMaxRate) return false;
+    if (in_rate == in_rate_ && out_rate == out_rate_) return true;
+    if (in_rate <= out_rate) {
+      taps_ = resampler_up_taps;
+    } else if (in_rate * 44100LL <= out_rate * 50000LL) {
+      taps_ = resampler_down1_taps;
+    } else {
+      taps_ = resampler_down2_taps;
+    }
+    step_ = (((uint64_t)in_rate << 16) + out_rate / 2) / out_rate;
+    in_rate_ = in_rate;
+    out_rate_ = out_rate;
+    clear();
+    return true;
+  }
+
+  void clear() {
+    memset(history_, 0, sizeof(history_));
+    pos_ = 0;
+    phase_ = 65536;
+  }
+
+  void Push(int16_t sample) {
+    history_[pos_] = history_[pos_ + RESAMPLER_TAPS] = sample;
+    if (++pos_ == RESAMPLER_TAPS) pos_ = 0;
+    phase_ -= 65536;
+  }
+
+  bool Ready() const { return phase_ < 65536; }
+
+  int16_t Next() {
+    const int frac_bits = 16 - kPhaseBits;
+    int row = phase_ >> frac_bits;
+    int frac = phase_ & ((1 << frac_bits) - 1);
+    int32_t a = Dot(taps_[row]) >> RESAMPLER_COEFF_BITS;
+    int32_t b = Dot(taps_[row + 1]) >> RESAMPLER_COEFF_BITS;
+    phase_ += step_;
+    return clamptoi16(a + (((b - a) * frac) >> frac_bits));
+  }
+
+private:
+  static const int kPhaseBits = 5;
+  static_assert((1 << kPhaseBits) == RESAMPLER_PHASES, "phase bits");
+
+  int32_t Dot(const int16_t* coeffs) const {
+    const int16_t* h = history_ + pos_;
+    int32_t acc = 0;
+#if defined(__ARM_FEATURE_DSP) && !defined(TEENSYDUINO)
+    for (int i = 0; i < RESAMPLER_TAPS; i += 2) {
+      uint32_t x, c;
+      memcpy(&x, h + i, 4);
+      memcpy(&c, coeffs + i, 4);
+      acc = __SMLAD(x, c, acc);
+    }
+#else
+    for (int i = 0; i < RESAMPLER_TAPS; i++) acc += h[i] * coeffs[i];
+#endif
+    return acc;
+  }
+
+  const int16_t (*taps_)[RESAMPLER_TAPS] = resampler_up_taps;
+  int in_rate_ = 0;
+  int out_rate_ = 0;
+  // Input samples per output sample, 16.16
+  uint32_t step_ = 65536;
+  // Position of the next output sample between the two
+  // center samples of the window, 16.16
+  int32_t phase_ = 65536;
+  int pos_ = 0;
+  // Each sample is stored twice, so that the window is always contiguous.
+  int16_t history_[RESAMPLER_TAPS * 2] __attribute__((aligned(4)));
+};
+
+#endif
@@ -0,0 +1,120 @@
+// Generated by make_resampler_tables.cpp, do not edit.
+#ifndef SOUND_RESAMPLER_TABLES_H
+#define SOUND_RESAMPLER_TABLES_H
+
+#define RESAMPLER_TAPS 24
+#define RESAMPLER_PHASES 32
+#define RESAMPLER_COEFF_BITS 14
+
+// Upsampling, cutoff just below the input nyquist frequency.
+static const int16_t resampler_up_taps[RESAMPLER_PHASES + 1][RESAMPLER_TAPS] __attribute__((aligned(4))) = {
+  {-7,0,29,-97,218,-399,636,-908,1183,-1420,1582,14750,1582,-1420,1183,-908,636,-399,218,-97,29,0,-7,0},
+  {-5,-4,36,-107,228,-404,625,-867,1087,-1220,1110,14729,2072,-1616,1271,-942,641,-391,206,-86,22,4,-9,4},
+  {-3,-8,43,-115,236,-405,610,-820,985,-1017,658,14669,2579,-1806,1353,-970,642,-380,192,-75,13,9,-11,5},
+  {-1,-12,49,-123,241,-403,590,-769,878,-814,229,14575,3101,-1989,1426,-991,637,-366,176,-62,5,14,-13,6},
+  {1,-15,54,-129,245,-398,567,-712,768,-611,-178,14436,3637,-2162,1489,-1004,627,-348,159,-48,-4,19,-15,6},
+  {2,-19,59,-134,246,-389,539,-651,654,-410,-560,14264,4183,-2325,1542,-1009,612,-326,139,-33,-13,23,-17,7},
+  {4,-22,63,-137,246,-378,508,-587,539,-213,-916,14053,4738,-2476,1585,-1007,592,-302,118,-18,-23,28,-19,8},
+  {5,-24,67,-140,243,-365,474,-520,422,-21,-1246,13809,5299,-2612,1616,-996,566,-274,95,-2,-32,33,-21,8},
+  {6,-26,69,-141,239,-348,436,-450,305,165,-1550,13531,5865,-2733,1634,-977,535,-244,71,15,-42,38,-23,9},
+  {7,-28,71,-141,233,-330,397,-379,189,344,-1825,13216,6433,-2836,1641,-950,499,-210,45,32,-52,43,-25,10},
+  {8,-30,73,-140,225,-309,355,-306,75,514,-2073,12875,6999,-2921,1634,-914,458,-175,18,49,-61,47,-27,10},
+  {9,-31,74,-138,216,-286,311,-233,-37,675,-2292,12499,7563,-2986,1614,-870,412,-136,-9,66,-71,52,-28,10},
+  {10,-32,74,-135,205,-262,266,-160,-146,825,-2483,12098,8122,-3030,1580,-818,362,-96,-38,84,-80,56,-29,11},
+  {10,-33,73,-130,193,-236,220,-87,-250,964,-2646,11672,8672,-3051,1533,-758,307,-54,-66,101,-89,59,-31,11},
+  {11,-33,72,-125,180,-210,174,-16,-350,1091,-2780,11219,9212,-3048,1471,-691,249,-10,-95,118,-97,63,-32,11},
+  {11,-33,71,-119,166,-182,127,54,-445,1206,-2887,10743,9739,-3020,1397,-615,187,35,-125,134,-105,66,-32,11},
+  {11,-33,68,-113,150,-153,81,122,-533,1308,-2967,10251,10251,-2967,1308,-533,122,81,-153,150,-113,68,-33,11},
+  {11,-32,66,-105,134,-125,35,187,-615,1397,-3020,9739,10743,-2887,1206,-445,54,127,-182,166,-119,71,-33,11},
+  {11,-32,63,-97,118,-95,-10,249,-691,1471,-3048,9212,11219,-2780,1091,-350,-16,174,-210,180,-125,72,-33,11},
+  {11,-31,59,-89,101,-66,-54,307,-758,1533,-3051,8672,11672,-2646,964,-250,-87,220,-236,193,-130,73,-33,10},
+  {11,-29,56,-80,84,-38,-96,362,-818,1580,-3030,8122,12098,-2483,825,-146,-160,266,-262,205,-135,74,-32,10},
+  {10,-28,52,-71,66,-9,-136,412,-870,1614,-2986,7563,12499,-2292,675,-37,-233,311,-286,216,-138,74,-31,9},
+  {10,-27,47,-61,49,18,-175,458,-914,1634,-2921,6999,12875,-2073,514,75,-306,355,-309,225,-140,73,-30,8},
+  {10,-25,43,-52,32,45,-210,499,-950,1641,-2836,6433,13216,-1825,344,189,-379,397,-330,233,-141,71,-28,7},
+  {9,-23,38,-42,15,71,-244,535,-977,1634,-2733,5865,13531,-1550,165,305,-450,436,-348,239,-141,69,-26,6},
+  {8,-21,33,-32,-2,95,-274,566,-996,1616,-2612,5299,13809,-1246,-21,422,-520,474,-365,243,-140,67,-24,5},
+  {8,-19,28,-23,-18,118,-302,592,-1007,1585,-2476,4738,14053,-916,-213,539,-587,508,-378,246,-137,63,-22,4},
+  {7,-17,23,-13,-33,139,-326,612,-1009,1542,-2325,4183,14264,-560,-410,654,-651,539,-389,246,-134,59,-19,2},
+  {6,-15,19,-4,-48,159,-348,627,-1004,1489,-2162,3637,14436,-178,-611,768,-712,567,-398,245,-129,54,-15,1},
+  {6,-13,14,5,-62,176,-366,637,-991,1426,-1989,3101,14575,229,-814,878,-769,590,-403,241,-123,49,-12,-1},
+  {5,-11,9,13,-75,192,-380,642,-970,1353,-1806,2579,14669,658,-1017,985,-820,610,-405,236,-115,43,-8,-3},
+  {4,-9,4,22,-86,206,-391,641,-942,1271,-1616,2072,14729,1110,-1220,1087,-867,625,-404,228,-107,36,-4,-5},
+  {0,-7,0,29,-97,218,-399,636,-908,1183,-1420,1582,14750,1582,-1420,1183,-908,636,-399,218,-97,29,0,-7},
+};
+
+// Downsampling from up to 50kHz, cutoff below 22kHz.
+static const int16_t resampler_down1_taps[RESAMPLER_PHASES + 1][RESAMPLER_TAPS] __attribute__((aligned(4))) = {
+  {-15,-9,85,-149,51,281,-634,506,525,-2324,4089,11572,4089,-2324,525,506,-634,281,51,-149,85,-9,-15,0},
+  {-13,-12,86,-141,32,298,-620,442,609,-2321,3743,11556,4435,-2313,435,567,-644,262,70,-156,83,-5,-16,7},
+  {-12,-15,86,-133,14,313,-604,379,688,-2309,3401,11528,4783,-2291,341,628,-651,242,90,-162,81,-2,-18,7},
+  {-10,-17,87,-124,-4,326,-585,315,762,-2285,3064,11478,5132,-2257,242,688,-656,219,109,-168,78,2,-19,7},
+  {-9,-20,86,-115,-22,337,-564,251,830,-2252,2732,11416,5481,-2210,139,745,-657,195,129,-174,75,5,-21,7},
+  {-7,-22,86,-106,-39,346,-541,188,892,-2208,2405,11330,5828,-2150,32,800,-655,170,148,-178,71,9,-22,7},
+  {-6,-24,84,-97,-55,354,-516,125,948,-2156,2085,11229,6173,-2077,-78,853,-650,142,168,-182,67,13,-23,7},
+  {-5,-26,83,-87,-71,359,-489,64,998,-2094,1772,11110,6515,-1991,-190,902,-641,113,186,-185,62,17,-25,7},
+  {-3,-27,81,-77,-85,362,-460,3,1042,-2025,1467,10969,6852,-1891,-305,949,-629,83,205,-187,57,22,-26,7},
+  {-2,-29,79,-67,-99,364,-429,-56,1080,-1948,1172,10811,7185,-1778,-422,992,-613,52,223,-188,51,26,-27,7},
+  {-1,-30,76,-58,-112,363,-397,-113,1111,-1864,885,10642,7511,-1651,-541,1031,-594,20,240,-188,45,30,-28,7},
+  {0,-31,73,-48,-124,361,-365,-168,1136,-1774,608,10453,7831,-1510,-660,1066,-571,-14,257,-188,39,35,-29,7},
+  {1,-31,70,-38,-135,357,-331,-221,1155,-1678,342,10251,8142,-1357,-780,1097,-545,-48,273,-186,31,39,-30,6},
+  {2,-32,67,-28,-145,352,-296,-272,1167,-1577,87,10030,8445,-1189,-899,1123,-515,-83,288,-183,24,43,-31,6},
+  {3,-32,63,-19,-154,344,-261,-320,1174,-1472,-157,9799,8738,-1008,-1017,1144,-483,-118,302,-180,16,47,-31,6},
+  {4,-32,60,-10,-162,336,-225,-365,1175,-1362,-388,9552,9021,-815,-1135,1159,-447,-154,314,-175,8,52,-32,5},
+  {4,-32,56,-1,-169,326,-189,-407,1170,-1250,-608,9292,9292,-608,-1250,1170,-407,-189,326,-169,-1,56,-32,4},
+  {5,-32,52,8,-175,314,-154,-447,1159,-1135,-815,9021,9552,-388,-1362,1175,-365,-225,336,-162,-10,60,-32,4},
+  {6,-31,47,16,-180,302,-118,-483,1144,-1017,-1008,8738,9799,-157,-1472,1174,-320,-261,344,-154,-19,63,-32,3},
+  {6,-31,43,24,-183,288,-83,-515,1123,-899,-1189,8445,10030,87,-1577,1167,-272,-296,352,-145,-28,67,-32,2},
+  {6,-30,39,31,-186,273,-48,-545,1097,-780,-1357,8142,10251,342,-1678,1155,-221,-331,357,-135,-38,70,-31,1},
+  {7,-29,35,39,-188,257,-14,-571,1066,-660,-1510,7831,10453,608,-1774,1136,-168,-365,361,-124,-48,73,-31,0},
+  {7,-28,30,45,-188,240,20,-594,1031,-541,-1651,7511,10642,885,-1864,1111,-113,-397,363,-112,-58,76,-30,-1},
+  {7,-27,26,51,-188,223,52,-613,992,-422,-1778,7185,10811,1172,-1948,1080,-56,-429,364,-99,-67,79,-29,-2},
+  {7,-26,22,57,-187,205,83,-629,949,-305,-1891,6852,10969,1467,-2025,1042,3,-460,362,-85,-77,81,-27,-3},
+  {7,-25,17,62,-185,186,113,-641,902,-190,-1991,6515,11110,1772,-2094,998,64,-489,359,-71,-87,83,-26,-5},
+  {7,-23,13,67,-182,168,142,-650,853,-78,-2077,6173,11229,2085,-2156,948,125,-516,354,-55,-97,84,-24,-6},
+  {7,-22,9,71,-178,148,170,-655,800,32,-2150,5828,11330,2405,-2208,892,188,-541,346,-39,-106,86,-22,-7},
+  {7,-21,5,75,-174,129,195,-657,745,139,-2210,5481,11416,2732,-2252,830,251,-564,337,-22,-115,86,-20,-9},
+  {7,-19,2,78,-168,109,219,-656,688,242,-2257,5132,11478,3064,-2285,762,315,-585,326,-4,-124,87,-17,-10},
+  {7,-18,-2,81,-162,90,242,-651,628,341,-2291,4783,11528,3401,-2309,688,379,-604,313,14,-133,86,-15,-12},
+  {7,-16,-5,83,-156,70,262,-644,567,435,-2313,4435,11556,3743,-2321,609,442,-620,298,32,-141,86,-12,-13},
+  {0,-15,-9,85,-149,51,281,-634,506,525,-2324,4089,11572,4089,-2324,525,506,-634,281,51,-149,85,-9,-15},
+};
+
+// Downsampling from up to 100kHz, cutoff below 20kHz.
+static const int16_t resampler_down2_taps[RESAMPLER_PHASES + 1][RESAMPLER_TAPS] __attribute__((aligned(4))) = {
+  {-8,-49,-50,88,269,151,-430,-918,-267,1930,4583,5786,4583,1930,-267,-918,-430,151,269,88,-50,-49,-8,0},
+  {-7,-48,-51,81,265,162,-408,-915,-312,1845,4512,5784,4651,2015,-220,-920,-451,139,271,94,-48,-50,-9,4},
+  {-6,-46,-53,75,262,173,-386,-910,-356,1761,4440,5779,4718,2101,-171,-921,-473,126,274,100,-46,-51,-10,4},
+  {-5,-45,-55,69,258,183,-364,-905,-397,1677,4367,5771,4783,2188,-121,-920,-494,114,276,107,-43,-53,-11,4},
+  {-4,-44,-56,63,254,193,-343,-898,-438,1594,4292,5767,4847,2274,-70,-919,-516,100,278,113,-41,-54,-12,4},
+  {-4,-42,-57,57,250,202,-321,-891,-476,1512,4217,5753,4909,2361,-16,-916,-537,86,279,120,-38,-55,-13,4},
+  {-3,-41,-58,51,246,211,-300,-882,-513,1430,4140,5739,4970,2448,39,-912,-558,72,281,126,-36,-56,-14,4},
+  {-2,-39,-59,46,241,219,-278,-873,-548,1350,4062,5721,5028,2536,95,-906,-579,57,281,133,-33,-57,-15,4},
+  {-2,-38,-60,40,236,227,-257,-862,-582,1270,3982,5704,5085,2623,153,-899,-599,42,282,139,-30,-58,-16,4},
+  {-1,-37,-61,35,231,234,-236,-851,-614,1191,3902,5681,5140,2711,213,-891,-619,26,282,146,-26,-58,-18,4},
+  {0,-35,-61,29,226,240,-215,-839,-644,1114,3821,5657,5193,2798,274,-881,-639,10,281,152,-23,-59,-19,4},
+  {0,-34,-62,24,220,246,-195,-826,-672,1037,3739,5635,5243,2885,337,-870,-659,-7,280,159,-20,-60,-20,4},
+  {1,-32,-62,19,215,252,-175,-812,-699,961,3656,5603,5292,2973,401,-857,-678,-24,279,165,-16,-60,-21,3},
+  {1,-31,-62,14,209,257,-155,-797,-725,887,3573,5573,5339,3060,466,-843,-697,-41,277,172,-12,-61,-23,3},
+  {2,-30,-62,10,203,262,-135,-782,-748,814,3489,5537,5383,3146,533,-827,-715,-59,275,178,-8,-61,-24,3},
+  {2,-28,-62,5,197,266,-115,-766,-770,741,3404,5502,5426,3232,601,-810,-732,-78,272,185,-4,-62,-25,3},
+  {2,-27,-62,0,191,269,-96,-750,-791,671,3318,5468,5466,3318,671,-791,-750,-96,269,191,0,-62,-27,2},
+  {3,-25,-62,-4,185,272,-78,-732,-810,601,3232,5426,5502,3404,741,-770,-766,-115,266,197,5,-62,-28,2},
+  {3,-24,-61,-8,178,275,-59,-715,-827,533,3146,5383,5537,3489,814,-748,-782,-135,262,203,10,-62,-30,2},
+  {3,-23,-61,-12,172,277,-41,-697,-843,466,3060,5339,5573,3573,887,-725,-797,-155,257,209,14,-62,-31,1},
+  {3,-21,-60,-16,165,279,-24,-678,-857,401,2973,5292,5603,3656,961,-699,-812,-175,252,215,19,-62,-32,1},
+  {4,-20,-60,-20,159,280,-7,-659,-870,337,2885,5243,5635,3739,1037,-672,-826,-195,246,220,24,-62,-34,0},
+  {4,-19,-59,-23,152,281,10,-639,-881,274,2798,5193,5657,3821,1114,-644,-839,-215,240,226,29,-61,-35,0},
+  {4,-18,-58,-26,146,282,26,-619,-891,213,2711,5140,5681,3902,1191,-614,-851,-236,234,231,35,-61,-37,-1},
+  {4,-16,-58,-30,139,282,42,-599,-899,153,2623,5085,5704,3982,1270,-582,-862,-257,227,236,40,-60,-38,-2},
+  {4,-15,-57,-33,133,281,57,-579,-906,95,2536,5028,5721,4062,1350,-548,-873,-278,219,241,46,-59,-39,-2},
+  {4,-14,-56,-36,126,281,72,-558,-912,39,2448,4970,5739,4140,1430,-513,-882,-300,211,246,51,-58,-41,-3},
+  {4,-13,-55,-38,120,279,86,-537,-916,-16,2361,4909,5753,4217,1512,-476,-891,-321,202,250,57,-57,-42,-4},
+  {4,-12,-54,-41,113,278,100,-516,-919,-70,2274,4847,5767,4292,1594,-438,-898,-343,193,254,63,-56,-44,-4},
+  {4,-11,-53,-43,107,276,114,-494,-920,-121,2188,4783,5771,4367,1677,-397,-905,-364,183,258,69,-55,-45,-5},
+  {4,-10,-51,-46,100,274,126,-473,-921,-171,2101,4718,5779,4440,1761,-356,-910,-386,173,262,75,-53,-46,-6},
+  {4,-9,-50,-48,94,271,139,-451,-920,-220,2015,4651,5784,4512,1845,-312,-915,-408,162,265,81,-51,-48,-7},
+  {0,-8,-49,-50,88,269,151,-430,-918,-267,1930,4583,5786,4583,1930,-267,-918,-430,151,269,88,-50,-49,-8},
+};
+
+#endif
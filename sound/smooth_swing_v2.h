@@ -114,6 +114,12 @@ public:
     uint32_t delta = t - last_micros_;
     if (delta > 1000000) delta = 1;
     last_micros_ = t;
+    // The swing volumes are ramped from one motion update to the next,
+    // so that they change a little bit every sample instead of in steps.
+    // The next update is expected as long from now as this one was from
+    // the last one. The ramp is never longer than 20ms, so that the sound
+    // still follows the swing when an update is very late.
+    uint32_t ramp = clampi32(delta * (AUDIO_RATE / 1000) / 1000, 1, AUDIO_RATE / 50);
     float hum_volume = 1.0;
 
     switch (state_) {
@@ -179,13 +185,16 @@ public:
           if (on_) {
             // We need to stop setting the volume when off, or playback may never stop.
             mixhum = delegate_->SetSwingVolume(swing_strength, mixhum);
-            A.set_volume(mixhum * mixab);
-            B.set_volume(mixhum * (1.0 - mixab));
+            A.set_volume(mixhum * mixab, ramp);
+            B.set_volume(mixhum * (1.0 - mixab), ramp);
           }
           break;
         }
-        A.set_volume(0);
-        B.set_volume(0);
+        if (on_) {
+          // When off, the players are already fading out.
+          A.set_volume(0, ramp);
+          B.set_volume(0, ramp);
+        }
         state_ = SwingState::OUT;
 
       case SwingState::OUT:
@@ -203,15 +212,15 @@ public:
 
 private:
   struct Data {
-    void set_volume(float v) {
-      if (player) player->set_volume(v);
+    void set_volume(float v, uint32_t samples) {
+      if (player) player->set_volume_ramp(v, samples);
     }
     void Play(Effect* effect, float start = 0.0) {
       if (!player) {
-	player = GetFreeWavPlayer();
+	player = GetFreeWavPlayer(Effect::Priority::LOOP);
 	if (!player) return;
       }
-      player->set_volume(0.0f);
+      player->set_volume_now(0.0f);
       player->PlayOnce(effect, start);
       player->PlayLoop(effect);
     }
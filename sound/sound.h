@@ -20,6 +20,15 @@ Talkie talkie;
 // LightSaberSynth saber_synth;
 #include "buffered_audio_stream.h"
 
+// Called from the main loop when a font is activated. Players which
+// are still playing from the RAM cache are stopped first.
+void ClearWavRamCache() {
+  for (size_t unit = 0; unit < NELEM(wav_players); unit++) {
+    if (wav_players[unit].from_ram()) wav_players[unit].Stop();
+  }
+  wav_ram_cache.Clear();
+}
+
 size_t WhatUnit(class BufferedWavPlayer* player);
 
 #include "effect.h"
@@ -28,7 +37,27 @@ size_t WhatUnit(class BufferedWavPlayer* player);
 BufferedWavPlayer wav_players[NUM_WAV_PLAYERS];
 RefPtr<BufferedWavPlayer> track_player_;
 
-RefPtr<BufferedWavPlayer> GetFreeWavPlayer()  {
+// Shown by "top".
+uint32_t wav_player_steals = 0;
+uint32_t wav_player_drops = 0;
+
+Effect::Priority WavPlayerPriority(const BufferedWavPlayer& player) {
+  const Effect* effect = player.current_file_id().GetEffect();
+  return effect ? effect->GetPriority() : Effect::Priority::NORMAL;
+}
+
+// Returns true if |a| should be taken over before |b|.
+bool BetterWavPlayerToSteal(BufferedWavPlayer& a, BufferedWavPlayer& b) {
+  if (WavPlayerPriority(a) != WavPlayerPriority(b))
+    return WavPlayerPriority(a) < WavPlayerPriority(b);
+  if (a.volume() != b.volume()) return a.volume() < b.volume();
+  return a.pos() > b.pos();
+}
+
+// If no wav player is free, a sound with |priority| takes over the player
+// playing the least important, quietest and oldest sound with lower priority.
+// Players that someone holds on to (hum, lockup, swings) are never taken.
+RefPtr<BufferedWavPlayer> GetFreeWavPlayer(Effect::Priority priority = Effect::Priority::MENU)  {
   // Find a free wave playback unit.
   for (size_t unit = 0; unit < NELEM(wav_players); unit++) {
     if (wav_players[unit].Available()) {
@@ -36,7 +65,30 @@ RefPtr<BufferedWavPlayer> GetFreeWavPlayer()  {
       return RefPtr<BufferedWavPlayer>(wav_players + unit);
     }
   }
-  return RefPtr<BufferedWavPlayer>();
+  BufferedWavPlayer* victim = nullptr;
+  for (size_t unit = 0; unit < NELEM(wav_players); unit++) {
+    BufferedWavPlayer* player = wav_players + unit;
+    if (player->refs() || WavPlayerPriority(*player) >= priority) continue;
+    if (!victim || BetterWavPlayerToSteal(*player, *victim)) victim = player;
+  }
+  if (!victim) {
+    wav_player_drops++;
+    return RefPtr<BufferedWavPlayer>();
+  }
+  wav_player_steals++;
+  // The old sound fades out over the next audio block, the new
+  // one starts right after it. No need to wait for it here.
+  victim->CutOff();
+  return RefPtr<BufferedWavPlayer>(victim);
+}
+
+void DumpWavPlayerStats() {
+  STDOUT.print("WAV players taken over: ");
+  STDOUT.print(wav_player_steals);
+  STDOUT.print(" sounds dropped: ");
+  STDOUT.println(wav_player_drops);
+  wav_player_steals = 0;
+  wav_player_drops = 0;
 }
 
 RefPtr<BufferedWavPlayer> GetWavPlayerPlaying(Effect* effect) {
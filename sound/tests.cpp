@@ -58,9 +58,8 @@ public:
 
 char* itoa( int value, char *string, int radix )
 {
-  static char ret[33];
-  sprintf(ret, "%d", value);
-  return ret;
+  sprintf(string, "%d", value);
+  return string;
 }
 
 // This really ought to be a typedef, but it causes problems I don't understand.
@@ -198,6 +197,64 @@ void test_effects() {
   CHECK_EQ(0, SFX_hum.files_found());
 }
 
+void test_font_index() {
+  char name1[128], name2[128];
+
+  mktestdir();
+  mkdir("testfont/clsh", -1);
+  touch("testfont/hum.wav");
+  touch("testfont/swing01.wav");
+  touch("testfont/swing02.wav");
+  touch("testfont/swing03.wav");
+  touch("testfont/clsh/clsh1.wav");
+  touch("testfont/clsh/clsh2.wav");
+  Effect::ScanCurrentDirectory();
+  CHECK(LSFS::Exists("testfont/" FONT_INDEX_FILENAME));
+  CHECK_EQ(1, SFX_hum.files_found());
+  CHECK_EQ(3, SFX_swing.files_found());
+  CHECK_EQ(2, SFX_clsh.files_found());
+  SFX_swing.GetName(name1, 2, false);
+  CHECK_STREQ("testfont/swing03.wav", name1);
+
+  // Loading from the index gives the same result.
+  Effect::ScanCurrentDirectory();
+  CHECK_EQ(1, SFX_hum.files_found());
+  CHECK_EQ(3, SFX_swing.files_found());
+  CHECK_EQ(2, SFX_clsh.files_found());
+  CHECK_EQ(0, SFX_blst.files_found());
+  SFX_swing.GetName(name2, 2, false);
+  CHECK_STREQ(name1, name2);
+  SFX_clsh.GetName(name2, 1, false);
+  CHECK_STREQ("testfont/clsh/clsh2.wav", name2);
+
+  // New files in the top directory invalidate the index.
+  touch("testfont/swing04.wav");
+  touch("testfont/blst.wav");
+  Effect::ScanCurrentDirectory();
+  CHECK_EQ(4, SFX_swing.files_found());
+  CHECK_EQ(1, SFX_blst.files_found());
+
+  // So do new files in subdirectories.
+  touch("testfont/clsh/clsh3.wav");
+  Effect::ScanCurrentDirectory();
+  CHECK_EQ(3, SFX_clsh.files_found());
+
+  // Removing the indexes doesn't change anything.
+  Effect::RemoveIndexes();
+  Effect::ScanCurrentDirectory();
+  CHECK_EQ(3, SFX_clsh.files_found());
+
+  // Broken index files are ignored.
+  FILE* f = fopen("testfont/" FONT_INDEX_FILENAME, "w");
+  CHECK(f);
+  fputs("garbage", f);
+  fclose(f);
+  Effect::ScanCurrentDirectory();
+  CHECK_EQ(4, SFX_swing.files_found());
+  CHECK_EQ(3, SFX_clsh.files_found());
+}
+
 int main() {
   test_effects();
+  test_font_index();
 }
@@ -1,8 +1,9 @@
 #ifndef SOUND_VOLUME_OVERLAY_H
 #define SOUND_VOLUME_OVERLAY_H
 
-const uint32_t kVolumeShift = 14;
-const uint32_t kMaxVolume = 1 << kVolumeShift;
+#include "audiostream.h"
+#include "click_avoider_lin.h"
+
 const uint32_t kDefaultVolume = kMaxVolume / 2;
 // 1 / 500 second for to change the volume. (2ms)
 const uint32_t kDefaultSpeed = 500 * kMaxVolume / AUDIO_RATE;
@@ -43,6 +44,27 @@ public:
     }
     return elements;
   }
+  int read_raw(int16_t* data, int elements, int32_t* start, int32_t* end) override {
+    *start = volume_.value();
+    if (volume_.isConstant()) {
+      *end = *start;
+      elements = T::read(data, elements);
+      if (*start == 0 && stop_when_zero_) {
+        volume_.set_speed(kDefaultSpeed);
+        T::Stop();
+      }
+      return elements;
+    }
+    // Stop before the last (shorter) step of the fade, so that the
+    // gain changes by exactly speed_ per sample. The last step is read
+    // by itself in the next call.
+    uint32_t distance = abs((int32_t)(volume_.target_ - volume_.value()));
+    uint32_t steps = std::max<uint32_t>(distance / std::max<uint32_t>(volume_.speed_, 1), 1);
+    elements = T::read(data, std::min<uint32_t>(elements, steps));
+    volume_.advance(elements);
+    *end = volume_.value();
+    return elements;
+  }
   float volume() {
     return volume_.value() * (1.0f / (1 << kVolumeShift));
   }
@@ -67,6 +89,16 @@ public:
   void set_volume_now(float vol) {
     set_volume_now((int)(kDefaultVolume * vol));
   }
+  // Changes the volume linearly to |vol| over |samples| samples,
+  // with the same step for every sample.
+  void set_volume_ramp(int vol, uint32_t samples) {
+    uint32_t distance = abs(vol - (int)volume_.value());
+    volume_.set_speed(std::max<uint32_t>(1, (distance + samples - 1) / samples));
+    volume_.set_target(vol);
+  }
+  void set_volume_ramp(float vol, uint32_t samples) {
+    set_volume_ramp((int)(kDefaultVolume * vol), samples);
+  }
   void set_speed(int speed) {
     volume_.set_speed(speed);
   }
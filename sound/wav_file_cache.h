@@ -0,0 +1,277 @@
+#ifndef SOUND_WAV_FILE_CACHE_H
+#define SOUND_WAV_FILE_CACHE_H
+
+#include "audio_stream_work.h"
+#include "effect.h"
+#include "ima_adpcm.h"
+
+// Format of a sound file, and where the samples are.
+struct WavInfo {
+  bool wav = false;
+  uint8_t channels = 1;
+  uint8_t bits = 16;
+  uint16_t block_align = 2;
+  uint32_t rate = 44100;
+  // Position and size of the first data chunk.
+  uint32_t data_offset = 0;
+  uint32_t data_len = 0;
+};
+
+// Parses the header of a .wav or .raw file and leaves |file|
+// positioned at the first sample. Returns false on errors.
+inline bool ReadWavHeader(FileReader* file, const char* filename, WavInfo* info) {
+  uint32_t header[4];
+  info->wav = endswith(".wav", filename);
+  if (!info->wav) {
+    info->channels = 1;
+    info->rate = 44100;
+    info->bits = 16;
+    info->block_align = 2;
+    info->data_offset = file->Tell();
+    info->data_len = file->FileSize() - info->data_offset;
+    return true;
+  }
+  if (file->Read((uint8_t*)header, 12) != 12) {
+    default_output->println("Failed to read 12 bytes.");
+    return false;
+  }
+  if (header[0] != 0x46464952 || header[2] != 0x45564157) {
+    default_output->println("Not RIFF WAVE.");
+    return false;
+  }
+
+  // Look for FMT header.
+  uint32_t len;
+  while (true) {
+    if (file->Read((uint8_t*)header, 8) != 8) {
+      default_output->println("Failed to read 8 bytes.");
+      return false;
+    }
+    len = header[1];
+    if (header[0] != 0x20746D66) {  // 'fmt '
+      file->Skip(len);
+      continue;
+    }
+    if (len < 16) {
+      default_output->println("FMT header is wrong size..");
+      return false;
+    }
+    break;
+  }
+
+  if (16 != file->Read((uint8_t*)header, 16)) {
+    default_output->println("Read failed.");
+    return false;
+  }
+  if (len > 16) file->Skip(len - 16);
+  info->channels = header[0] >> 16;
+  info->rate = header[1];
+  info->bits = header[3] >> 16;
+  info->block_align = header[3] & 0xffff;
+  switch (header[0] & 0xffff) {
+    case 1:
+      if (info->bits == 4) {
+        default_output->println("Wrong format.");
+        return false;
+      }
+      break;
+    case IMA_ADPCM_FORMAT:
+      if (info->bits != 4 || info->channels < 1 || info->channels > 2 ||
+          info->block_align <= 4 * info->channels ||
+          (info->block_align % (4 * info->channels))) {
+        default_output->println("Wrong format.");
+        return false;
+      }
+      break;
+    default:
+      default_output->println("Wrong format.");
+      return false;
+  }
+
+  // Look for the data.
+  while (true) {
+    if (file->Read((uint8_t*)header, 8) != 8) {
+      default_output->println("No data.");
+      return false;
+    }
+    if (header[0] == 0x61746164) break;  // 'data'
+    file->Skip(header[1]);
+  }
+  info->data_offset = file->Tell();
+  info->data_len = header[1];
+  return true;
+}
+
+#ifndef WAV_FILE_CACHE_SIZE
+#define WAV_FILE_CACHE_SIZE 4
+#endif
+
+#if WAV_FILE_CACHE_SIZE > 0
+
+// Keeps a few effect files open with their headers parsed, so that
+// playing them doesn't have to wait for the SD card to open the file
+// and read the header. Files are opened ahead of time by Prefetch(),
+// which asks for the file that the effect's next RandomFile() will
+// pick. PlayWav also hands over files it's done with, so recently
+// played files stay open too. Least recently used entries are closed
+// first.
+//
+// Opening files happens in FillBuffer(), which runs in the same
+// context as PlayWav::loop(), after all audio buffers have been
+// filled, so nothing here needs to lock out the other.
+class WavFileCache : private AudioStreamWork {
+public:
+  // Called from the main loop.
+  void Prefetch(Effect::FileID id) {
+    if (!id) return;
+    noInterrupts();
+    if (num_wanted_ < WAV_FILE_CACHE_SIZE) {
+      wanted_[num_wanted_++] = id;
+    }
+    interrupts();
+    scheduleFillBuffer();
+  }
+  void Prefetch(Effect* effect) {
+    Prefetch(effect->PeekRandomFile());
+  }
+
+  // If |want| is open, swap it with |file|, which holds |have|.
+  // |have| then stays open in the cache.
+  bool Exchange(Effect::FileID want, Effect::FileID have,
+                FileReader* file, WavInfo* info) {
+    Entry* e = Find(want);
+    if (!e) return false;
+    e->file.Swap(*file);
+    std::swap(*info, e->info);
+    // Files given back at the end of playback are not at the start.
+    file->Seek(info->data_offset);
+    e->id = have;
+    e->last_used = ++clock_;
+    if (!have || !e->file.IsOpen()) Evict(e);
+    hits_++;
+    return true;
+  }
+
+  // Takes over |file|, which holds |id|.
+  void Give(Effect::FileID id, FileReader* file, const WavInfo& info) {
+    if (!id || Find(id)) return;
+    Entry* e = LeastRecentlyUsed();
+    Evict(e);
+    e->file.MoveFrom(*file);
+    if (!e->file.IsOpen()) return;
+    e->id = id;
+    e->info = info;
+    e->last_used = ++clock_;
+  }
+
+  void CountMiss() { misses_++; }
+  uint32_t hits() const { return hits_; }
+  uint32_t misses() const { return misses_; }
+
+  void Dump() {
+    STDOUT << "Wav file cache hits: " << hits_ << " misses: " << misses_ << "\n";
+  }
+
+protected:
+  size_t space_available() const override {
+    return num_wanted_;
+  }
+
+  bool FillBuffer() override {
+    if (!num_wanted_) return false;
+    noInterrupts();
+    Effect::FileID id = wanted_[--num_wanted_];
+    interrupts();
+    Entry* e = Find(id);
+    if (e) {
+      e->last_used = ++clock_;
+      return true;
+    }
+    e = LeastRecentlyUsed();
+    Evict(e);
+    char filename[128];
+    id.GetName(filename, false);
+    if (!e->file.OpenFast(filename)) return true;
+    if (!ReadWavHeader(&e->file, filename, &e->info)) {
+      e->file.Close();
+      return true;
+    }
+    e->id = id;
+    e->last_used = ++clock_;
+    return true;
+  }
+
+  void CloseFiles() override {
+    for (size_t i = 0; i < NELEM(entries_); i++) Evict(entries_ + i);
+  }
+
+private:
+  struct Entry {
+    Effect::FileID id;
+    uint32_t last_used = 0;
+    FileReader file;
+    WavInfo info;
+  };
+
+  Entry* Find(Effect::FileID id) {
+    if (!id) return nullptr;
+    CheckGeneration();
+    for (size_t i = 0; i < NELEM(entries_); i++) {
+      if (entries_[i].id == id) return entries_ + i;
+    }
+    return nullptr;
+  }
+
+  Entry* LeastRecentlyUsed() {
+    CheckGeneration();
+    Entry* ret = entries_;
+    for (size_t i = 0; i < NELEM(entries_); i++) {
+      if (!entries_[i].id) return entries_ + i;
+      if (entries_[i].last_used < ret->last_used) ret = entries_ + i;
+    }
+    return ret;
+  }
+
+  void Evict(Entry* e) {
+    e->id = Effect::FileID();
+    e->file.Close();
+  }
+
+  // After a font change, FileIDs refer to different files.
+  void CheckGeneration() {
+    if (generation_ == Effect::generation()) return;
+    CloseFiles();
+    generation_ = Effect::generation();
+  }
+
+  Entry entries_[WAV_FILE_CACHE_SIZE];
+  Effect::FileID wanted_[WAV_FILE_CACHE_SIZE];
+  volatile int num_wanted_ = 0;
+  uint32_t generation_ = 0;
+  uint32_t clock_ = 0;
+  uint32_t hits_ = 0;
+  uint32_t misses_ = 0;
+};
+
+#else  // WAV_FILE_CACHE_SIZE > 0
+
+class WavFileCache {
+public:
+  void Prefetch(Effect::FileID id) {}
+  void Prefetch(Effect* effect) {}
+  bool Exchange(Effect::FileID want, Effect::FileID have,
+                FileReader* file, WavInfo* info) {
+    return false;
+  }
+  void Give(Effect::FileID id, FileReader* file, const WavInfo& info) {}
+  void CountMiss() {}
+  uint32_t hits() const { return 0; }
+  uint32_t misses() const { return 0; }
+  void Dump() {}
+};
+
+#endif  // WAV_FILE_CACHE_SIZE > 0
+
+WavFileCache wav_file_cache;
+
+#endif
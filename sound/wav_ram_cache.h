@@ -0,0 +1,153 @@
+#ifndef SOUND_WAV_RAM_CACHE_H
+#define SOUND_WAV_RAM_CACHE_H
+
+#include "audio_stream_work.h"
+#include "effect.h"
+#include "wav_file_cache.h"
+
+// Bytes of RAM used to keep short effects in memory, 0 disables it.
+#ifndef WAV_RAM_CACHE_SIZE
+#define WAV_RAM_CACHE_SIZE 0
+#endif
+
+// Maximum number of files kept in memory.
+#ifndef WAV_RAM_CACHE_FILES
+#define WAV_RAM_CACHE_FILES 16
+#endif
+
+#if WAV_RAM_CACHE_SIZE > 0
+
+// Keeps the samples of short, latency-sensitive effects (clash, blast,
+// stab...) in RAM, so that playing them doesn't touch the SD card at all.
+// The font decides what goes in, by calling Add() for each effect in
+// order of importance when it is activated. Only files which are
+// already 44.1kHz, 16-bit mono are kept, PlayWav copies those straight
+// into the audio buffers. Files that don't fit are played from SD.
+// The cache is emptied when the font changes, see ClearWavRamCache().
+class WavRamCache {
+public:
+  // Empties the cache. Called from the main loop, after
+  // Effect::ScanCurrentDirectory() and after stopping all players
+  // that play from the cache, since their data is about to be
+  // overwritten. (See ClearWavRamCache().)
+  void Clear() {
+    noInterrupts();
+    num_entries_ = 0;
+    used_ = 0;
+    generation_ = Effect::generation();
+    interrupts();
+  }
+
+  // Called from the main loop, after Clear().
+  void Add(Effect* effect) {
+    if (generation_ != Effect::generation()) return;
+    for (size_t i = 0; i < effect->files_found(); i++) {
+      if (num_entries_ == WAV_RAM_CACHE_FILES) return;
+      Effect::FileID id(effect, i);
+      if (Find(id)) continue;
+      Load(id);
+    }
+  }
+
+  bool Contains(Effect::FileID id) { return Find(id) != nullptr; }
+
+  // If |id| is in memory, opens it in |file|. PlayWav then plays it
+  // like a .raw file.
+  bool Open(Effect::FileID id, FileReader* file, WavInfo* info) {
+    Entry* e = Find(id);
+    if (!e) return false;
+    file->OpenMem(data_ + e->offset, e->len);
+    *info = WavInfo();
+    info->data_len = e->len;
+    hits_++;
+    return true;
+  }
+
+  uint32_t hits() const { return hits_; }
+
+  void Dump() {
+    STDOUT << "Wav RAM cache files: " << num_entries_
+           << " bytes: " << used_ << "/" << WAV_RAM_CACHE_SIZE
+           << " hits: " << hits_ << "\n";
+  }
+
+private:
+  struct Entry {
+    Effect::FileID id;
+    uint32_t offset;
+    uint32_t len;
+  };
+
+  Entry* Find(Effect::FileID id) {
+    if (!id) return nullptr;
+    // After a font change, FileIDs refer to different files.
+    if (generation_ != Effect::generation()) return nullptr;
+    for (int i = 0; i < num_entries_; i++) {
+      if (entries_[i].id == id) return entries_ + i;
+    }
+    return nullptr;
+  }
+
+  void Load(Effect::FileID id) {
+    char filename[128];
+    id.GetName(filename, false);
+    FileReader f;
+    WavInfo info;
+    LOCK_SD(true);
+    bool ok = f.Open(filename) &&
+      ReadWavHeader(&f, filename, &info) &&
+      info.data_len > 0 &&
+      info.bits == 16 && info.channels == 1 && info.rate == AUDIO_RATE &&
+      info.data_len <= WAV_RAM_CACHE_SIZE - used_;
+    // Read a few blocks at a time, so that playing sounds don't run dry.
+    for (uint32_t pos = 0; ok && pos < info.data_len; pos += 2048) {
+      LOCK_SD(true);
+      int n = std::min<uint32_t>(2048, info.data_len - pos);
+      ok = f.Read(data_ + used_ + pos, n) == n;
+      LOCK_SD(false);
+      AudioStreamWork::scheduleFillBuffer();
+    }
+    LOCK_SD(true);
+    f.Close();
+    LOCK_SD(false);
+    if (!ok) return;
+    Entry* e = entries_ + num_entries_;
+    e->id = id;
+    e->offset = used_;
+    e->len = info.data_len & ~1;
+    // Keep the samples aligned.
+    used_ += (info.data_len + 3) & ~3;
+    // Find() may run in an interrupt, only let it see the entry
+    // once it's complete.
+    noInterrupts();
+    num_entries_++;
+    interrupts();
+  }
+
+  Entry entries_[WAV_RAM_CACHE_FILES];
+  volatile int num_entries_ = 0;
+  uint32_t used_ = 0;
+  uint32_t generation_ = 0;
+  uint32_t hits_ = 0;
+  uint8_t data_[WAV_RAM_CACHE_SIZE] __attribute__((aligned(4)));
+};
+
+#else  // WAV_RAM_CACHE_SIZE > 0
+
+class WavRamCache {
+public:
+  void Clear() {}
+  void Add(Effect* effect) {}
+  bool Contains(Effect::FileID id) { return false; }
+  bool Open(Effect::FileID id, FileReader* file, WavInfo* info) {
+    return false;
+  }
+  uint32_t hits() const { return 0; }
+  void Dump() {}
+};
+
+#endif  // WAV_RAM_CACHE_SIZE > 0
+
+WavRamCache wav_ram_cache;
+
+#endif
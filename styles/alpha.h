@@ -19,25 +19,59 @@ public:
   LayerRunResult run(BladeBase* blade) {
     LayerRunResult base_run_result = RunLayer(&color_, blade);
     FunctionRunResult ret = RunFunction(&alpha_, blade);
+    alpha_run_result_ = ret;
     switch (ret) {
       case FunctionRunResult::ONE_UNTIL_IGNITION: return base_run_result;
       case FunctionRunResult::ZERO_UNTIL_IGNITION: return LayerRunResult::TRANSPARENT_UNTIL_IGNITION;
+      case FunctionRunResult::UNCHANGED:
+	if (base_run_result != LayerRunResult::UNKNOWN)
+	  return LayerRunResult::UNCHANGED;
+	break;
       case FunctionRunResult::UNKNOWN: break;
     }
     return LayerRunResult::UNKNOWN;
   }
 
 private:
+  // Remembered so that constant alpha values can skip getInteger().
+  FunctionRunResult alpha_run_result_ = FunctionRunResult::UNKNOWN;
   PONUA COLOR color_;
   PONUA ALPHA alpha_;
 
 public:
   auto getColor(int led) -> decltype(color_.getColor(led) * alpha_.getInteger(led))  {
 //    SCOPED_PROFILER();
+    switch (alpha_run_result_) {
+      case FunctionRunResult::ZERO_UNTIL_IGNITION: return RGBA_um_nod::Transparent();
+      case FunctionRunResult::ONE_UNTIL_IGNITION: return color_.getColor(led) * 32768;
+      default: break;
+    }
     int alpha = alpha_.getInteger(led);
     if (alpha == 0) return RGBA_um_nod::Transparent();
     return color_.getColor(led) * alpha;  // clamp?
   }
+  template<class C> void getColors(int begin, int end, C* out) {
+    int n = end - begin;
+    if (alpha_run_result_ == FunctionRunResult::ZERO_UNTIL_IGNITION) {
+      for (int i = 0; i < n; i++) out[i] = RGBA_um_nod::Transparent();
+      return;
+    }
+    decltype(color_.getColor(0)) colors[STYLE_BATCH_SIZE];
+    GetColors(&color_, begin, end, colors);
+    if (alpha_run_result_ == FunctionRunResult::ONE_UNTIL_IGNITION) {
+      for (int i = 0; i < n; i++) out[i] = colors[i] * 32768;
+      return;
+    }
+    int alpha[STYLE_BATCH_SIZE];
+    GetIntegers(&alpha_, begin, end, alpha);
+    for (int i = 0; i < n; i++) {
+      if (alpha[i] == 0) {
+	out[i] = RGBA_um_nod::Transparent();
+      } else {
+	out[i] = colors[i] * alpha[i];
+      }
+    }
+  }
 };
 
 // To enable Gradient/Mixes constricted within Bump<> and SmoothStep<> layers
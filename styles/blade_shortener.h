@@ -27,6 +27,7 @@ public:
   bool IsHandled(HandledFeature feature) { return style_->IsHandled(feature); }
 
   int num_leds() const override { return num_leds_; }
+  bool skip_frame() override { return false; }
   void set_length(int length) {
     num_leds_ = length;
   }
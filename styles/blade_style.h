@@ -1,6 +1,8 @@
 #ifndef STYLES_BLADE_STYLE_H
 #define STYLES_BLADE_STYLE_H
 
+#include "style_profiling.h"
+
 class BladeBase;
 
 // Base class for blade styles.
@@ -47,16 +49,23 @@ class StyleFactoryImpl : public StyleFactory {
   }
 };
 
+// run() functions in layers and functions can return one of these to
+// tell the caller that the result is not going to change.
+// UNCHANGED means that getColor()/getInteger() returns the same thing
+// as it did after the previous call to run(), unless that call returned
+// UNKNOWN. The *_UNTIL_IGNITION values imply UNCHANGED.
 enum class LayerRunResult {
   UNKNOWN,
   OPAQUE_BLACK_UNTIL_IGNITION,
   TRANSPARENT_UNTIL_IGNITION,
+  UNCHANGED,
 };
 
 enum class FunctionRunResult {
   UNKNOWN,
   ZERO_UNTIL_IGNITION,
-  ONE_UNTIL_IGNITION
+  ONE_UNTIL_IGNITION,
+  UNCHANGED,
 };
 
 template<class T, typename X> struct RunStyleHelper {
@@ -84,6 +93,7 @@ template<class T> struct RunStyleHelper<T, LayerRunResult> {
 // magic to detect which way to run the function.
 template<class T>
 inline bool RunStyle(T* style, BladeBase* blade) {
+  STYLE_PROFILER(T, true);
   return RunStyleHelper<T, decltype(style->run(blade))>::run(style, blade);
 }
 
@@ -108,10 +118,58 @@ template<class T> struct RunLayerHelper<T, bool> {
   
 template<class T>
 inline LayerRunResult RunLayer(T* style, BladeBase* blade) {
+  STYLE_PROFILER(T, true);
   return RunLayerHelper<T, decltype(style->run(blade))>::run(style, blade);
 };
 
 
+// Colors, layers and functions may also implement a batch version of
+// getColor() / getInteger():
+//   template<class C> void getColors(int begin, int end, C* out);
+//   void getIntegers(int begin, int end, int* out);
+// These fill out[0 .. end - begin) with the same values that getColor()
+// or getInteger() would return for those LEDs. end - begin is never larger
+// than STYLE_BATCH_SIZE, so temporary arrays can live on the stack.
+// GetColors() and GetIntegers() call the batch version if it exists,
+// otherwise they fall back to calling getColor()/getInteger() per LED.
+#ifndef STYLE_BATCH_SIZE
+#define STYLE_BATCH_SIZE 8
+#endif
+
+template<class T, class C>
+inline auto GetColorsHelper(T* style, int begin, int end, C* out, int)
+  -> decltype(style->getColors(begin, end, out)) {
+  return style->getColors(begin, end, out);
+}
+
+template<class T, class C>
+inline void GetColorsHelper(T* style, int begin, int end, C* out, long) {
+  for (int i = begin; i < end; i++) out[i - begin] = style->getColor(i);
+}
+
+template<class T, class C>
+inline void GetColors(T* style, int begin, int end, C* out) {
+  STYLE_PROFILER(T, false);
+  GetColorsHelper(style, begin, end, out, 0);
+}
+
+template<class T>
+inline auto GetIntegersHelper(T* f, int begin, int end, int* out, int)
+  -> decltype(f->getIntegers(begin, end, out)) {
+  return f->getIntegers(begin, end, out);
+}
+
+template<class T>
+inline void GetIntegersHelper(T* f, int begin, int end, int* out, long) {
+  for (int i = begin; i < end; i++) out[i - begin] = f->getInteger(i);
+}
+
+template<class T>
+inline void GetIntegers(T* f, int begin, int end, int* out) {
+  STYLE_PROFILER(T, false);
+  GetIntegersHelper(f, begin, end, out, 0);
+}
+
 template<class T, typename X> struct RunFunctionHelper {
   static FunctionRunResult run(T* style, BladeBase* blade) {
     return style->ThisIsAnError();
@@ -139,6 +197,7 @@ template<class T> struct RunFunctionHelper<T, bool> {
   
 template<class T>
 inline FunctionRunResult RunFunction(T* style, BladeBase* blade) {
+  STYLE_PROFILER(T, true);
   return RunFunctionHelper<T, decltype(style->run(blade))>::run(style, blade);
 };
 
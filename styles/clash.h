@@ -18,7 +18,7 @@ template<class CLASH_COLOR = Rgb<255,255,255>, int CLASH_MILLIS = 40,
   class STAB_SHAPE = SmoothStep<Int<16384>, Int<24000>> >
 class SimpleClashL {
 public:
-  void run(BladeBase* blade) {
+  LayerRunResult run(BladeBase* blade) {
     clash_color_.run(blade);
     stab_shape_.run(blade);
     // This should make us activate the clash at least one "frame".
@@ -29,6 +29,8 @@ public:
       clash_ = true;
       stab_ = EFFECT == EFFECT_CLASH && e->type == EFFECT_STAB && blade->num_leds() > 1;
     }
+    // A new clash wakes the blade up again, so idle is transparent until then.
+    return clash_ ? LayerRunResult::UNKNOWN : LayerRunResult::TRANSPARENT_UNTIL_IGNITION;
   }
 private:
   OneshotEffectDetector<EFFECT> effect_;
@@ -82,7 +84,7 @@ template<
   BladeEffectType EFFECT = EFFECT_CLASH>
 class LocalizedClashL {
 public:
-  void run(BladeBase* blade) {
+  LayerRunResult run(BladeBase* blade) {
     clash_color_.run(blade);
     // This should make us activate the clash at least one "frame".
     if (BladeEffect* e = effect_.Detect(blade)) {
@@ -94,6 +96,7 @@ public:
     } else {
       clash_ = false;
     }
+    return clash_ ? LayerRunResult::UNKNOWN : LayerRunResult::TRANSPARENT_UNTIL_IGNITION;
   }
 private:
   OneshotEffectDetector<EFFECT> effect_;
@@ -5,16 +5,32 @@
 
 #include "../sound/audio_stream_work.h"
 
-template<bool USE_HUM>
+// Number of frames read ahead from the .blc file.
+// Each frame uses 512 * FRAME_BLOCKS bytes of RAM.
+#ifndef FROM_FILE_STYLE_FRAMES
+#define FROM_FILE_STYLE_FRAMES 4
+#endif
+
+template<bool USE_HUM, int FRAME_BLOCKS>
 class FromFileStyleBase : private AudioStreamWork {
 protected:
+  static const int FRAME_BYTES = 512 * FRAME_BLOCKS; // SD blocks are 512 bytes!
   struct Frame {
     volatile uint32_t frame;
-    volatile char data[512]; // SD blocks are 512 bytes!
+    volatile char data[FRAME_BYTES];
   };
-  Frame& CurrentFrame() { return frames_[current_]; }
-  Frame& BackFrame() { return frames_[1-current_]; }
-  
+  static_assert(FROM_FILE_STYLE_FRAMES >= 2, "FROM_FILE_STYLE_FRAMES must be at least 2");
+  static int NextSlot(int slot) {
+    return slot + 1 == FROM_FILE_STYLE_FRAMES ? 0 : slot + 1;
+  }
+  static int PrevSlot(int slot) {
+    return slot == 0 ? FROM_FILE_STYLE_FRAMES - 1 : slot - 1;
+  }
+  // While nothing has been read, the frame shown before the
+  // buffer was flushed is still in the previous slot.
+  Frame& CurrentFrame() { return frames_[count_ ? read_ : PrevSlot(read_)]; }
+  Frame& NextFrame() { return frames_[NextSlot(read_)]; }
+
   RefPtr<BufferedWavPlayer>& getPlayer() {
     if (USE_HUM) {
       return hybrid_font.hum_player_;
@@ -22,102 +38,164 @@ protected:
       return track_player_;
     }
   }
-  virtual uint32_t FrameNum() = 0;
+  // Current position in frames, with 8 fractional bits.
+  virtual uint32_t FramePos() = 0;
+  uint32_t FrameNum() { return FramePos() >> 8; }
 
 public:
   void run(BladeBase* blade) {
     num_leds_ = blade->num_leds();
-    if (next_available_) {
-      uint32_t frame = FrameNum();
-      if (frame >= BackFrame().frame || frame < CurrentFrame().frame) {
-	noInterrupts();
-	current_ = 1 - current_;
-	next_available_ = false;
-	interrupts();
-	scheduleFillBuffer();
-      }
+    uint32_t pos = FramePos();
+    uint32_t frame = pos >> 8;
+    noInterrupts();
+    if (count_ && frame < CurrentFrame().frame) {
+      // Rewound, throw away everything we've read.
+      Flush();
     }
+    // Keep the last frame at or before |frame|.
+    while (count_ >= 2 && NextFrame().frame <= frame) {
+      read_ = NextSlot(read_);
+      count_--;
+    }
+    interrupts();
+    // Blend in the next frame if it's already here and we're not behind.
+    fraction_ = 0;
+    if (count_ >= 2 && CurrentFrame().frame == frame &&
+	NextFrame().frame == frame + 1) {
+      fraction_ = pos & 0xff;
+    }
+    if (count_ < FROM_FILE_STYLE_FRAMES) scheduleFillBuffer();
   }
   size_t space_available() const override {
-    if (millis() - last_open_ < 500) return 0;
-    return next_available_ ? 0 : 1;
+    if (last_open_ && millis() - last_open_ < 500) return 0;
+    if (eof_) return 0;
+    return FROM_FILE_STYLE_FRAMES - count_;
   }
   bool FillBuffer() override {
     if (!file_.IsOpen()) {
-      uint32_t now = millis();
-      if (!now) now++;
-      if (now - last_open_ < 500) return false;
-      last_open_ = now;
       if (!getPlayer()) return false;
       if (!getPlayer()->isPlaying()) return false;
       if (!*getPlayer()->filename()) return false;
       strcpy(filename, getPlayer()->filename());
       int x = strlen(filename);
       if (x > 4) strcpy(filename + x - 3, "blc");
-      file_.Open(filename);
+      if (file_.Open(filename)) {
+	last_open_ = 0;
+      } else {
+	// Don't look for a missing file too often.
+	last_open_ = millis();
+	if (!last_open_) last_open_++;
+      }
+      noInterrupts();
+      Flush();
+      interrupts();
       // Yield to make sure we don't upset the audio.
       return false;
     }
-    if (!next_available_) {
-      uint32_t frame = FrameNum();
-      if (frame == CurrentFrame().frame) frame++;
-      file_.Seek(frame * sizeof(BackFrame().data));
-      file_.Read((uint8_t*)BackFrame().data, sizeof(BackFrame().data));
-      BackFrame().frame = frame;
-      next_available_ = true;
+    if (count_ == FROM_FILE_STYLE_FRAMES || eof_) return false;
+    // Frames are read in order, only seek if playback jumped
+    // or if we fell behind.
+    uint32_t frame = FrameNum();
+    if (!count_ || next_frame_ < frame) {
+      next_frame_ = frame;
+      file_.Seek(frame * FRAME_BYTES);
+    }
+    int slot = read_ + count_;
+    if (slot >= FROM_FILE_STYLE_FRAMES) slot -= FROM_FILE_STYLE_FRAMES;
+    if (file_.Read((uint8_t*)frames_[slot].data, FRAME_BYTES) != FRAME_BYTES) {
+      eof_ = true;
+      return false;
     }
+    frames_[slot].frame = next_frame_++;
+    count_++;
     return true;
   }
   void CloseFiles() override {
     file_.Close();
   }
 protected:
+  // Throws away all frames. The frame currently shown stays where it is,
+  // and new frames are read into the slots after it. Interrupts must be off.
+  void Flush() {
+    if (count_) read_ = NextSlot(read_);
+    count_ = 0;
+    eof_ = false;
+  }
+
   // Approximate sRGB -> linear calculation
   uint16_t sqr(uint8_t x) { return x * x; }
 
+  uint16_t getChannel(int offset) {
+    uint32_t ret = sqr(CurrentFrame().data[offset]);
+    if (fraction_) {
+      ret = (ret * (256 - fraction_) + sqr(NextFrame().data[offset]) * fraction_) >> 8;
+    }
+    return ret;
+  }
+
   static char filename[128];
-  static Frame frames_[2];
-  static volatile int current_;
-  static volatile bool next_available_;
+  static Frame frames_[FROM_FILE_STYLE_FRAMES];
+  // frames_[read_] is the frame currently shown, followed by
+  // count_ - 1 frames read ahead. (See CurrentFrame() for count_ == 0.)
+  static volatile int read_;
+  static volatile int count_;
+  // Frame number that the file is positioned at.
+  static uint32_t next_frame_;
+  static volatile bool eof_;
   static volatile uint32_t last_open_;
   static FileReader file_;
   int num_leds_;
+  uint32_t fraction_ = 0;
 };
 
 // Note, unused variables go away automatically...
-template<bool USE_HUM> char FromFileStyleBase<USE_HUM>::filename[128];
-template<bool USE_HUM> typename FromFileStyleBase<USE_HUM>::Frame FromFileStyleBase<USE_HUM>::frames_[2];
-template<bool USE_HUM> volatile int FromFileStyleBase<USE_HUM>::current_;
-template<bool USE_HUM> volatile bool FromFileStyleBase<USE_HUM>::next_available_;
-template<bool USE_HUM> volatile uint32_t FromFileStyleBase<USE_HUM>::last_open_;
-template<bool USE_HUM> FileReader FromFileStyleBase<USE_HUM>::file_;
+template<bool USE_HUM, int FRAME_BLOCKS> char FromFileStyleBase<USE_HUM, FRAME_BLOCKS>::filename[128];
+template<bool USE_HUM, int FRAME_BLOCKS> typename FromFileStyleBase<USE_HUM, FRAME_BLOCKS>::Frame FromFileStyleBase<USE_HUM, FRAME_BLOCKS>::frames_[FROM_FILE_STYLE_FRAMES];
+template<bool USE_HUM, int FRAME_BLOCKS> volatile int FromFileStyleBase<USE_HUM, FRAME_BLOCKS>::read_;
+template<bool USE_HUM, int FRAME_BLOCKS> volatile int FromFileStyleBase<USE_HUM, FRAME_BLOCKS>::count_;
+template<bool USE_HUM, int FRAME_BLOCKS> uint32_t FromFileStyleBase<USE_HUM, FRAME_BLOCKS>::next_frame_;
+template<bool USE_HUM, int FRAME_BLOCKS> volatile bool FromFileStyleBase<USE_HUM, FRAME_BLOCKS>::eof_;
+template<bool USE_HUM, int FRAME_BLOCKS> volatile uint32_t FromFileStyleBase<USE_HUM, FRAME_BLOCKS>::last_open_;
+template<bool USE_HUM, int FRAME_BLOCKS> FileReader FromFileStyleBase<USE_HUM, FRAME_BLOCKS>::file_;
 
-template<int N = 170, int OFFSET=0, int FRAME_RATE_ENUMERATOR=30, int FRAME_RATE_DENOMINATOR=1>
-class FromFileStyle : public FromFileStyleBase<false> {
+template<bool USE_HUM, int N, int OFFSET, int FRAME_RATE_ENUMERATOR, int FRAME_RATE_DENOMINATOR, int FRAME_BLOCKS, bool INTERPOLATE>
+class FromFileStyleHelper : public FromFileStyleBase<USE_HUM, FRAME_BLOCKS> {
 public:
-  uint32_t FrameNum() override {
-    return floor(getPlayer()->pos() * FRAME_RATE_ENUMERATOR / FRAME_RATE_DENOMINATOR);
+  static_assert((N + OFFSET) * 3 <= 512 * FRAME_BLOCKS, "frames are too small, increase FRAME_BLOCKS");
+  uint32_t FramePos() override {
+    uint32_t pos = floor(this->getPlayer()->pos() * (256 * FRAME_RATE_ENUMERATOR) / FRAME_RATE_DENOMINATOR);
+    if (!INTERPOLATE) pos &= ~0xffU;
+    return pos;
   }
   SimpleColor getColor(int led) {
-    led = led * N / num_leds_ + OFFSET;
-    return SimpleColor(Color16(sqr(CurrentFrame().data[led*3]),
-			       sqr(CurrentFrame().data[led*3+1]),
-			       sqr(CurrentFrame().data[led*3+2])));
+    led = led * N / this->num_leds_ + OFFSET;
+    return SimpleColor(Color16(this->getChannel(led*3),
+			       this->getChannel(led*3+1),
+			       this->getChannel(led*3+2)));
   }
 };
 
-template<int N = 170, int OFFSET=0, int FRAME_RATE_ENUMERATOR=30, int FRAME_RATE_DENOMINATOR=1>
-class FromHumFileStyle : public FromFileStyleBase<true> {
-public:
-  uint32_t FrameNum() override {
-    return floor(getPlayer()->pos() * FRAME_RATE_ENUMERATOR / FRAME_RATE_DENOMINATOR);
-  }
-  SimpleColor getColor(int led) {
-    led = led * N / num_leds_ + OFFSET;
-    return SimpleColor(Color16(sqr(CurrentFrame().data[led*3]),
-			       sqr(CurrentFrame().data[led*3+1]),
-			       sqr(CurrentFrame().data[led*3+2])));
-  }
+// Usage: FromFileStyle<N, OFFSET, FRAME_RATE_ENUMERATOR, FRAME_RATE_DENOMINATOR, FRAME_BLOCKS, INTERPOLATE>
+// N: number of LEDs in each frame (defaults to 170)
+// OFFSET: first LED to use in each frame (defaults to 0)
+// FRAME_RATE_ENUMERATOR/FRAME_RATE_DENOMINATOR: frames per second (defaults to 30)
+// FRAME_BLOCKS: size of each frame in 512-byte blocks (defaults to 1)
+// INTERPOLATE: blend between frames (defaults to false)
+// return value: COLOR
+// Plays a .blc file in sync with the track. The file has the same
+// name as the track, but ends with .blc instead of .wav. Each frame
+// is FRAME_BLOCKS * 512 bytes, and holds 8-bit RGB values for the LEDs.
+// Use FRAME_BLOCKS = 2 or more for blades longer than 170 LEDs.
+// If INTERPOLATE is true, the colors are faded between frames, which
+// looks smoother when the blade updates faster than the frame rate.
+template<int N = 170, int OFFSET=0, int FRAME_RATE_ENUMERATOR=30, int FRAME_RATE_DENOMINATOR=1, int FRAME_BLOCKS=1, bool INTERPOLATE=false>
+class FromFileStyle : public FromFileStyleHelper<false, N, OFFSET, FRAME_RATE_ENUMERATOR, FRAME_RATE_DENOMINATOR, FRAME_BLOCKS, INTERPOLATE> {
+};
+
+// Usage: FromHumFileStyle<N, OFFSET, FRAME_RATE_ENUMERATOR, FRAME_RATE_DENOMINATOR, FRAME_BLOCKS, INTERPOLATE>
+// Same as FromFileStyle, but follows the hum instead of the track.
+template<int N = 170, int OFFSET=0, int FRAME_RATE_ENUMERATOR=30, int FRAME_RATE_DENOMINATOR=1, int FRAME_BLOCKS=1, bool INTERPOLATE=false>
+class FromHumFileStyle : public FromFileStyleHelper<true, N, OFFSET, FRAME_RATE_ENUMERATOR, FRAME_RATE_DENOMINATOR, FRAME_BLOCKS, INTERPOLATE> {
 };
 
 #endif  // ENABLE_AUDIO
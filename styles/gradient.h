@@ -58,6 +58,12 @@ public:
   auto getColor(int led) -> decltype(colors_.get(led, led * mul_)) {
     return colors_.get(led, led * mul_);
   }
+  template<class C> void getColors(int begin, int end, C* out) {
+    int mul = mul_;
+    for (int led = begin; led < end; led++) {
+      *(out++) = colors_.get(led, led * mul);
+    }
+  }
 };
 
 #endif
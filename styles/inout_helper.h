@@ -62,8 +62,11 @@ public:
 
     out_tr_.run(blade);
     in_tr_.run(blade);
-    if (ALLOW_DISABLE && !on_ && !out_tr_ && !in_tr_)
-      return can_turn_off;
+    if (!out_tr_ && !in_tr_) {
+      if (on_) return LayerRunResult::UNCHANGED;
+      if (ALLOW_DISABLE) return can_turn_off;
+      if (can_turn_off != LayerRunResult::UNKNOWN) return LayerRunResult::UNCHANGED;
+    }
     return LayerRunResult::UNKNOWN;
   }
 
@@ -23,25 +23,46 @@ public:
   LayerRunResult run(BladeBase* blade) {
     LayerRunResult base_run_result = RunLayer(&base_, blade);
     LayerRunResult layer_run_result = RunLayer(&layer_, blade);
+    layer_transparent_ = layer_run_result == LayerRunResult::TRANSPARENT_UNTIL_IGNITION;
     switch (layer_run_result) {
       case LayerRunResult::OPAQUE_BLACK_UNTIL_IGNITION:
 	return LayerRunResult::OPAQUE_BLACK_UNTIL_IGNITION;
       case LayerRunResult::TRANSPARENT_UNTIL_IGNITION:
 	return base_run_result;
+      case LayerRunResult::UNCHANGED:
+	if (base_run_result != LayerRunResult::UNKNOWN)
+	  return LayerRunResult::UNCHANGED;
+	break;
       case LayerRunResult::UNKNOWN:
 	break;
     }
     return LayerRunResult::UNKNOWN;
   }
 private:
+  // When the layer is known to be fully transparent for this frame
+  // (idle effects, Int<0> alpha, etc.) getColor() skips it entirely.
+  bool layer_transparent_ = false;
   PONUA BASE base_;
   PONUA L1 layer_;
 public:
   template<class T> T PRINT(T t, const char *f) { STDOUT << t << " @ " << f << "  type = " << __PRETTY_FUNCTION__ <<"\n"; return t; }
   auto getColor(int led) -> decltype(base_.getColor(led) << layer_.getColor(led)) {
+    if (layer_transparent_) return base_.getColor(led);
     return base_.getColor(led) << layer_.getColor(led);
 //    return PRINT(base_.getColor(led) << PRINT(layer_.getColor(led), "layer"), __PRETTY_FUNCTION__);
   }
+  template<class C> void getColors(int begin, int end, C* out) {
+    decltype(base_.getColor(0)) base[STYLE_BATCH_SIZE];
+    GetColors(&base_, begin, end, base);
+    int n = end - begin;
+    if (layer_transparent_) {
+      for (int i = 0; i < n; i++) out[i] = base[i];
+      return;
+    }
+    decltype(layer_.getColor(0)) layer[STYLE_BATCH_SIZE];
+    GetColors(&layer_, begin, end, layer);
+    for (int i = 0; i < n; i++) out[i] = base[i] << layer[i];
+  }
 };
 
 template<class BASE, class L1, class L2, class... LAYERS>
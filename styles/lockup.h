@@ -45,7 +45,7 @@ template<
 				Scale<IsLessThan<SlowNoise<Int<1500>>,Int<8000>>,Scale<NoisySoundLevel,Int<5000>,Int<0>>,Int<0>>>>  >
 class LockupL {
 public:
-  void run(BladeBase* blade) {
+  LayerRunResult run(BladeBase* blade) {
     single_pixel_ = blade->num_leds() == 1;
     lockup_.run(blade);
     if (!is_same_type<DRAG_COLOR, LOCKUP>::value)
@@ -54,6 +54,10 @@ public:
     drag_shape_.run(blade);
     lb_shape_.run(blade);
     handled_ = blade->current_style()->IsHandled(FeatureForLockupType(SaberBase::Lockup()));
+    // Lockup begin/end are effects, which wake the blade up.
+    if (handled_ || SaberBase::Lockup() == SaberBase::LOCKUP_NONE)
+      return LayerRunResult::TRANSPARENT_UNTIL_IGNITION;
+    return LayerRunResult::UNKNOWN;
   }
 private:
   bool handled_;
@@ -118,7 +122,7 @@ public:
   LockupTrL() {
     BladeBase::HandleFeature(FeatureForLockupType(LOCKUP_TYPE));
   }
-  void run(BladeBase* blade) {
+  LayerRunResult run(BladeBase* blade) {
     color_.run(blade);
     if (active_ != (SaberBase::Lockup() == LOCKUP_TYPE)) {
       if ((active_ = (SaberBase::Lockup() == LOCKUP_TYPE))) {
@@ -130,6 +134,8 @@ public:
 
     begin_tr_.run(blade);
     end_tr_.run(blade);
+    if (!active_ && !begin_tr_ && !end_tr_) return LayerRunResult::TRANSPARENT_UNTIL_IGNITION;
+    return LayerRunResult::UNKNOWN;
   }
 
 private:
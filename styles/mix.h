@@ -31,16 +31,45 @@ public:
   void run(BladeBase* blade) {
     a_.run(blade);
     b_.run(blade);
-    f_.run(blade);
+    f_run_result_ = RunFunction(&f_, blade);
   }
 private:
+  // If F is constant zero or one for this frame, only one side
+  // needs to be evaluated.
+  FunctionRunResult f_run_result_ = FunctionRunResult::UNKNOWN;
   PONUA A a_;
   PONUA B b_;
   PONUA F f_;
 public:
   auto getColor(int led) -> decltype(MixColors(a_.getColor(led), b_.getColor(led), f_.getInteger(led), 15)) {
+    switch (f_run_result_) {
+      case FunctionRunResult::ZERO_UNTIL_IGNITION: return a_.getColor(led);
+      case FunctionRunResult::ONE_UNTIL_IGNITION: return b_.getColor(led);
+      default: break;
+    }
     return MixColors(a_.getColor(led), b_.getColor(led), f_.getInteger(led), 15);
   }
+  template<class C> void getColors(int begin, int end, C* out) {
+    int n = end - begin;
+    decltype(a_.getColor(0)) a[STYLE_BATCH_SIZE];
+    decltype(b_.getColor(0)) b[STYLE_BATCH_SIZE];
+    switch (f_run_result_) {
+      case FunctionRunResult::ZERO_UNTIL_IGNITION:
+	GetColors(&a_, begin, end, a);
+	for (int i = 0; i < n; i++) out[i] = a[i];
+	return;
+      case FunctionRunResult::ONE_UNTIL_IGNITION:
+	GetColors(&b_, begin, end, b);
+	for (int i = 0; i < n; i++) out[i] = b[i];
+	return;
+      default: break;
+    }
+    int f[STYLE_BATCH_SIZE];
+    GetColors(&a_, begin, end, a);
+    GetColors(&b_, begin, end, b);
+    GetIntegers(&f_, begin, end, f);
+    for (int i = 0; i < n; i++) out[i] = MixColors(a[i], b[i], f[i], 15);
+  }
 };
 
 template<class... A> class MixHelper {};
@@ -22,9 +22,13 @@ class Remap {
 
  public:
   LayerRunResult run(BladeBase* blade) {
-    f_.run(blade);
+    FunctionRunResult f_ret = RunFunction(&f_, blade);
     num_leds_ = blade->num_leds();
-    return RunLayer(&color_, blade);
+    LayerRunResult ret = RunLayer(&color_, blade);
+    // The color is only uniform if it's known to be transparent or black.
+    if (ret == LayerRunResult::UNCHANGED && f_ret == FunctionRunResult::UNKNOWN)
+      return LayerRunResult::UNKNOWN;
+    return ret;
   }
   
   auto getColor(int led) -> decltype(color_.getColor(led)) {
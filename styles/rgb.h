@@ -28,7 +28,7 @@ public:
   static constexpr Color16 color() { return Color16(Color8(R,G,B)); }
   LayerRunResult run(BladeBase* base) {
     if (R == 0 && G == 0 && B == 0) return LayerRunResult::OPAQUE_BLACK_UNTIL_IGNITION;
-    return LayerRunResult::UNKNOWN;
+    return LayerRunResult::UNCHANGED;
   }
   SimpleColor getColor(int led) {
     return SimpleColor(color());
@@ -42,7 +42,7 @@ public:
   static Color16 color() { return Color16(R, G, B); }
   LayerRunResult run(BladeBase* base) {
     if (R == 0 && G == 0 && B == 0) return LayerRunResult::OPAQUE_BLACK_UNTIL_IGNITION;
-    return LayerRunResult::UNKNOWN;
+    return LayerRunResult::UNCHANGED;
   }
   SimpleColor getColor(int led) { return SimpleColor(color()); }
 };
@@ -51,7 +51,7 @@ public:
 template<int R, int G, int B, int A>
 class Rgba16 {
 public:
-  void run(BladeBase* base) {}
+  LayerRunResult run(BladeBase* base) { return LayerRunResult::UNCHANGED; }
   RGBA_um_nod getColor(int led) {
     return RGBA_um_nod(Color16(R, G, B), false, A >> 1);
   }
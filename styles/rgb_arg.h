@@ -17,7 +17,7 @@ public:
   LayerRunResult run(BladeBase* base) {
     if (color_.r == 0 && color_.g == 0 && color_.b == 0)
       return LayerRunResult::OPAQUE_BLACK_UNTIL_IGNITION;
-    return LayerRunResult::UNKNOWN;
+    return LayerRunResult::UNCHANGED;
   }
   SimpleColor getColor(int led) {
     return SimpleColor(color_);
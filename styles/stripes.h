@@ -80,6 +80,18 @@ public:
     colors_.get(led, p + 341 * colors_.size, &ret);
     return ret;
   }
+  void getColors(int begin, int end, SimpleColor* out) {
+    const int size = colors_.size * 341;
+    uint32_t mult = mult_;
+    uint32_t x = m + begin * mult;
+    for (int led = begin; led < end; led++, x += mult) {
+      int p = (x >> 10) % size;
+      out->c = Color16(0,0,0);
+      colors_.get(led, p, out);
+      colors_.get(led, p + size, out);
+      out++;
+    }
+  }
 private:
   StripesHelper<COLORS...> colors_;
   uint32_t mult_;
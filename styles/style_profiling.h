@@ -0,0 +1,146 @@
+#ifndef STYLES_STYLE_PROFILING_H
+#define STYLES_STYLE_PROFILING_H
+
+// #define ENABLE_STYLE_PROFILING
+
+// Style profiling counts how much time is spent in each part of a
+// blade style. When enabled, RunLayer(), RunFunction(), RunStyle(),
+// GetColors() and GetIntegers() time the node they call, keyed by
+// its type. The nodes form a tree, using the node that was running
+// when a node was first called as its parent. Nodes which call
+// their children directly, instead of through one of the helpers
+// above, count the time spent in those children as their own.
+// Identical types share one entry, even when used in more than one place.
+// Use the "style_top" command to print the results, after "top" has
+// enabled the cycle counter.
+
+#ifdef ENABLE_STYLE_PROFILING
+
+#ifdef PROFFIE_TEST
+#include <chrono>
+inline uint32_t StyleProfileCycles() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#elif defined(TEENSYDUINO)
+inline uint32_t StyleProfileCycles() { return ARM_DWT_CYCCNT; }
+#else
+inline uint32_t StyleProfileCycles() { return DWT->CYCCNT; }
+#endif
+
+class StyleProfileNode;
+StyleProfileNode* style_profile_nodes_ = nullptr;
+StyleProfileNode* current_style_profile_node_ = nullptr;
+
+class StyleProfileNode {
+public:
+  explicit StyleProfileNode(const char* pretty_function) {
+    // pretty_function looks like:
+    // "StyleProfileNode* GetStyleProfileNode() [with T = Layers<...>]"
+    const char* name = strstr(pretty_function, "T = ");
+    name_ = name ? name + 4 : pretty_function;
+    next_ = style_profile_nodes_;
+    style_profile_nodes_ = this;
+  }
+
+  // Length of the type name without template arguments.
+  int short_name_length() const {
+    int len = 0;
+    while (name_[len] && !strchr("<];", name_[len])) len++;
+    return len;
+  }
+
+  const char* name_;
+  StyleProfileNode* next_;
+  StyleProfileNode* parent_ = nullptr;
+  bool called_ = false;
+  // Time spent in run() and in getColor()/getInteger(),
+  // including all profiled children.
+  uint64_t run_cycles_ = 0;
+  uint64_t color_cycles_ = 0;
+  // Time spent in profiled children.
+  uint64_t child_cycles_ = 0;
+
+  uint64_t total_cycles() const { return run_cycles_ + color_cycles_; }
+  uint64_t self_cycles() const { return total_cycles() - child_cycles_; }
+};
+
+template<class T>
+StyleProfileNode* GetStyleProfileNode() {
+  static StyleProfileNode node(__PRETTY_FUNCTION__);
+  return &node;
+}
+
+class ScopedStyleProfiler {
+public:
+  ScopedStyleProfiler(StyleProfileNode* node, bool run) :
+    node_(node), parent_(current_style_profile_node_), run_(run) {
+    if (!node->called_) {
+      node->called_ = true;
+      node->parent_ = parent_;
+    }
+    current_style_profile_node_ = node;
+    start_ = StyleProfileCycles();
+  }
+  ~ScopedStyleProfiler() {
+    uint32_t cycles = StyleProfileCycles() - start_;
+    if (run_) {
+      node_->run_cycles_ += cycles;
+    } else {
+      node_->color_cycles_ += cycles;
+    }
+    if (parent_) parent_->child_cycles_ += cycles;
+    current_style_profile_node_ = parent_;
+  }
+private:
+  StyleProfileNode* node_;
+  StyleProfileNode* parent_;
+  bool run_;
+  uint32_t start_;
+};
+
+void DumpStyleProfileNode(StyleProfileNode* node, int depth, float total) {
+  for (int i = 0; i < depth; i++) STDOUT.print("  ");
+  STDOUT.print(node->total_cycles() * 100.0f / total);
+  STDOUT.print("% self ");
+  STDOUT.print(node->self_cycles() * 100.0f / total);
+  STDOUT.print("% run ");
+  STDOUT.print(node->run_cycles_ * 100.0f / total);
+  STDOUT.print("% color ");
+  STDOUT.print(node->color_cycles_ * 100.0f / total);
+  STDOUT.print("% ");
+  STDOUT.write((const uint8_t*)node->name_, node->short_name_length());
+  STDOUT.println("");
+  for (StyleProfileNode* n = style_profile_nodes_; n; n = n->next_) {
+    if (n->called_ && n->parent_ == node) DumpStyleProfileNode(n, depth + 1, total);
+  }
+}
+
+// Prints the tree of style nodes, as percentages of the time spent
+// in all styles, then starts over.
+void DumpStyleProfile() {
+  uint64_t total = 0;
+  for (StyleProfileNode* n = style_profile_nodes_; n; n = n->next_) {
+    if (n->called_ && !n->parent_) total += n->total_cycles();
+  }
+  if (total) {
+    for (StyleProfileNode* n = style_profile_nodes_; n; n = n->next_) {
+      if (n->called_ && !n->parent_) DumpStyleProfileNode(n, 0, total);
+    }
+  }
+  for (StyleProfileNode* n = style_profile_nodes_; n; n = n->next_) {
+    n->run_cycles_ = n->color_cycles_ = n->child_cycles_ = 0;
+  }
+}
+
+#define STYLE_PROFILER(T, RUN) \
+  ScopedStyleProfiler style_profiler_(GetStyleProfileNode<T>(), RUN)
+
+#else
+
+#define STYLE_PROFILER(T, RUN) do { } while(0)
+#define DumpStyleProfile() do { } while(0)
+
+#endif
+
+#endif
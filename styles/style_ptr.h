@@ -32,39 +32,71 @@ template<class RetType>
 class StyleHelper : public StyleBase {
 public:
   virtual RetType getColor2(int i) = 0;
+  // Fills out[0 .. end - begin), end - begin <= STYLE_BATCH_SIZE.
+  virtual void getColors2(int begin, int end, RetType* out) = 0;
   OverDriveColor getColor(int i) override { return getColor2(i); }
 
   template<bool ROTATE>
-  void runloop2(BladeBase* blade) {
+  void runloop2(BladeBase* blade, int rotation) {
     int num_leds = blade->num_leds();
-    int rotation = (SaberBase::GetCurrentVariation() & 0x7fff) * 3;
-    for (int i = 0; i < num_leds; i++) {
-      RetType c = getColor2(i);
-      if (ROTATE) c.c = c.c.rotate(rotation);
-      if (c.getOverdrive()) {
-         blade->set_overdrive(i, c.c);
-      } else {
+    RetType colors[STYLE_BATCH_SIZE];
+    // LEDs done since the last DoHFLoop().
+    int since_hf_loop = 16;
+    for (int begin = 0; begin < num_leds; begin += STYLE_BATCH_SIZE) {
+      int end = std::min(begin + STYLE_BATCH_SIZE, num_leds);
+      getColors2(begin, end, colors);
+      for (int i = begin; i < end; i++) {
+	RetType c = colors[i - begin];
+	if (ROTATE) c.c = c.c.rotate(rotation);
+	if (c.getOverdrive()) {
+	  blade->set_overdrive(i, c.c);
+	} else {
 #ifdef DYNAMIC_BLADE_DIMMING
-	c.c.r = clampi32((c.c.r * SaberBase::GetCurrentDimming()) >> 14, 0, 65535);
-	c.c.g = clampi32((c.c.g * SaberBase::GetCurrentDimming()) >> 14, 0, 65535);
-	c.c.b = clampi32((c.c.b * SaberBase::GetCurrentDimming()) >> 14, 0, 65535);
+	  c.c.r = clampi32((c.c.r * SaberBase::GetCurrentDimming()) >> 14, 0, 65535);
+	  c.c.g = clampi32((c.c.g * SaberBase::GetCurrentDimming()) >> 14, 0, 65535);
+	  c.c.b = clampi32((c.c.b * SaberBase::GetCurrentDimming()) >> 14, 0, 65535);
 #endif
-	blade->set(i, c.c);
+	  blade->set(i, c.c);
+	}
+      }
+      since_hf_loop += end - begin;
+      if (since_hf_loop >= 16) {
+	Looper::DoHFLoop();
+	since_hf_loop = 0;
       }
-      if (!(i & 0xf)) Looper::DoHFLoop();
     }
   }
 
-  void runloop(BladeBase* blade) {
+  // If |unchanged| is true, the style has returned the same colors
+  // as in the previous call, unless that call had |unchanged| = false.
+  void runloop(BladeBase* blade, bool unchanged = false) {
     bool rotate = !IsHandled(HANDLED_FEATURE_CHANGE) &&
       blade->get_byteorder() != Color8::NONE &&
       (SaberBase::GetCurrentVariation() & 0x7fff) != 0;
+    int rotation = rotate ? (SaberBase::GetCurrentVariation() & 0x7fff) * 3 : 0;
+#ifdef DYNAMIC_BLADE_DIMMING
+    int dimming = SaberBase::GetCurrentDimming();
+#else
+    int dimming = 0;
+#endif
+    bool same_frame = unchanged && last_unchanged_ &&
+      rotation == last_rotation_ && dimming == last_dimming_;
+    last_unchanged_ = unchanged;
+    last_rotation_ = rotation;
+    last_dimming_ = dimming;
+    if (same_frame && blade->skip_frame()) return;
+
     if (rotate) {
-      runloop2<true>(blade);
+      runloop2<true>(blade, rotation);
     } else {
-      runloop2<false>(blade);
+      runloop2<false>(blade, rotation);
     }
   }
+
+private:
+  bool last_unchanged_ = false;
+  int last_rotation_ = 0;
+  int last_dimming_ = 0;
 };
 
 template<class T>
@@ -78,10 +110,15 @@ public:
     return base_.getColor(i);
   }
 
+  void getColors2(int begin, int end, decltype(T().getColor(0))* out) override {
+    GetColors(&base_, begin, end, out);
+  }
+
   void run(BladeBase* blade) override {
-    if (!RunStyle(&base_, blade))
+    LayerRunResult result = RunLayer(&base_, blade);
+    if (result == LayerRunResult::OPAQUE_BLACK_UNTIL_IGNITION)
       blade->allow_disable();
-    this->runloop(blade);
+    this->runloop(blade, result != LayerRunResult::UNKNOWN);
   }
 private:
   T base_;
@@ -19,6 +19,7 @@ CONFIG preset = { 0,0 };
 CONFIG* current_config = &preset;
 
 #define PROFFIE_TEST
+#define ENABLE_STYLE_PROFILING
 
 #define COMMON_FUSE_H
 
@@ -131,6 +132,7 @@ Monitoring monitor;
 #include "brown_noise_flicker.h"
 #include "responsive_styles.h"
 #include "rainbow.h"
+#include "stripes.h"
 #include "legacy_styles.h"
 #include "rgb_arg.h"
 #include "inout_sparktip.h"
@@ -189,6 +191,13 @@ public:
   void allow_disable() override {
     allow_disable_ = true;
   }
+  bool skip_frame() override {
+    if (!keep_frames) return false;
+    skipped_frames++;
+    return true;
+  }
+  bool keep_frames = false;
+  int skipped_frames = 0;
   void Activate() override {
     fprintf(stderr, "NOT IMPLEMENTED\n");
     exit(1);
@@ -650,6 +659,189 @@ void test_argument_parsing() {
   testMaxUsedArgument("fire", 2);
 }
 
+// Runs a style for 1000 frames after fully turning on, and returns
+// how many frames could be skipped.
+int count_skipped_frames(BladeStyle* style) {
+  MockBlade mock_blade;
+  mock_blade.SetStyle(style);
+  mock_blade.colors.resize(10);
+  mock_blade.keep_frames = true;
+  on_ = true;
+  micros_ = 0;
+  for (int i = 0; i < 1000; i++) STEP();
+  mock_blade.skipped_frames = 0;
+  for (int i = 0; i < 1000; i++) STEP();
+  return mock_blade.skipped_frames;
+}
+
+void test_skip_frames() {
+  SaberBase::SetLockup(SaberBase::LOCKUP_NONE);
+  Style<InOutHelper<Rgb16<65535,65535,65535>, 100, 100, Rgb16<0,0,0>>> t1;
+  if (count_skipped_frames(&t1) != 1000) {
+    fprintf(stderr, "Static style should skip all frames.\n");
+    exit(1);
+  }
+
+  Style<InOutTr<Layers<Red,
+			SimpleClashL<White>,
+			LockupL<AudioFlickerL<White>>,
+			BlastL<White>>,
+		TrWipe<100>,
+		TrWipeIn<100>>> t2;
+  if (count_skipped_frames(&t2) != 1000) {
+    fprintf(stderr, "Idle effects should skip all frames.\n");
+    exit(1);
+  }
+
+  Style<InOutHelper<Pulsing<Red, Blue, 1000>, 100, 100>> t3;
+  if (count_skipped_frames(&t3) != 0) {
+    fprintf(stderr, "Pulsing style should not skip frames.\n");
+    exit(1);
+  }
+
+  // Retracting must not skip, but it's ok once it's done.
+  MockBlade mock_blade;
+  Style<InOutHelper<Rgb16<65535,65535,65535>, 100, 100, Rgb16<0,0,0>>> t4;
+  BladeStyle* style = &t4;
+  mock_blade.SetStyle(style);
+  mock_blade.colors.resize(1);
+  mock_blade.keep_frames = true;
+  on_ = true;
+  micros_ = 0;
+  for (int i = 0; i < 1000; i++) STEP();
+  on_ = false;
+  mock_blade.skipped_frames = 0;
+  for (int i = 0; i < 90; i++) STEP();
+  if (mock_blade.skipped_frames != 0) {
+    fprintf(stderr, "Should not skip frames when retracting.\n");
+    exit(1);
+  }
+  for (int i = 0; i < 110; i++) STEP();
+  if (mock_blade.colors[0].r != 0 || mock_blade.skipped_frames == 0) {
+    fprintf(stderr, "Should skip frames when retracted.\n");
+    exit(1);
+  }
+}
+
+// Opaque color that counts how many times it has been evaluated.
+int counted_color_calls = 0;
+class CountedWhite {
+public:
+  void run(BladeBase* blade) {}
+  SimpleColor getColor(int led) {
+    counted_color_calls++;
+    return SimpleColor(Color16(65535, 65535, 65535));
+  }
+};
+
+void test_constant_layers() {
+  SaberBase::SetLockup(SaberBase::LOCKUP_NONE);
+  Style<InOutHelper<Layers<Pulsing<Red, Blue, 1000>,
+			   AlphaL<CountedWhite, Int<0>>,
+			   SimpleClashL<CountedWhite>,
+			   LockupL<CountedWhite>,
+			   BlastL<CountedWhite>>, 100, 100>> t1;
+  count_skipped_frames(&t1);
+  if (counted_color_calls != 0) {
+    fprintf(stderr, "Transparent layers should not be evaluated, calls = %d\n",
+	    counted_color_calls);
+    exit(1);
+  }
+
+  Style<InOutHelper<Mix<Int<0>, Red, CountedWhite>, 100, 100>> t2;
+  count_skipped_frames(&t2);
+  if (counted_color_calls != 0) {
+    fprintf(stderr, "Mix<Int<0>> should not evaluate the second color.\n");
+    exit(1);
+  }
+
+  Style<InOutHelper<Layers<Red, AlphaL<CountedWhite, Int<32768>>>, 100, 100>> t3;
+  count_skipped_frames(&t3);
+  if (counted_color_calls == 0) {
+    fprintf(stderr, "Opaque layers must still be evaluated.\n");
+    exit(1);
+  }
+}
+
+// Checks that the batched getColors() path used by the style loop
+// produces exactly the same colors as calling getColor() per LED.
+void check_batch_colors(BladeStyle* style, const char* name) {
+  MockBlade mock_blade;
+  mock_blade.SetStyle(style);
+  mock_blade.colors.resize(37);
+  on_ = true;
+  micros_ = 0;
+  for (int i = 0; i < 300; i++) {
+    STEP();
+    for (int led = 0; led < 37; led++) {
+      Color16 c = style->getColor(led).c;
+      Color16 b = mock_blade.colors[led];
+      if (c.r != b.r || c.g != b.g || c.b != b.b) {
+	fprintf(stderr, "%s: batch color mismatch at led %d frame %d\n", name, led, i);
+	exit(1);
+      }
+    }
+  }
+}
+
+void test_batch_colors() {
+  Style<InOutHelper<Gradient<Red, Blue, Green>, 100, 100>> t1;
+  check_batch_colors(&t1, "gradient");
+  Style<InOutHelper<Stripes<1000, 1000, Red, Blue, Green>, 100, 100>> t2;
+  check_batch_colors(&t2, "stripes");
+  Style<InOutHelper<Layers<Blue,
+			   AlphaL<Red, SmoothStep<Int<16384>, Int<8000>>>,
+			   AlphaL<White, Bump<Int<10000>, Int<6000>>>,
+			   AlphaL<Green, Int<0>>>, 100, 100>> t3;
+  check_batch_colors(&t3, "alpha");
+  Style<InOutHelper<Mix<SmoothStep<Int<20000>, Int<-8000>>, Red,
+			Gradient<Blue, Green>>, 100, 100>> t4;
+  check_batch_colors(&t4, "mix");
+}
+
+typedef Layers<Rgb<1, 2, 3>, AlphaL<Red, SmoothStep<Int<12345>, Int<8000>>>> ProfiledLayers;
+
+void test_style_profile() {
+  Style<ProfiledLayers> t1;
+  BladeStyle* style = &t1;
+  MockBlade mock_blade;
+  mock_blade.SetStyle(&t1);
+  mock_blade.colors.resize(37);
+  on_ = true;
+  micros_ = 0;
+  for (int i = 0; i < 10; i++) STEP();
+
+  StyleProfileNode* layers = GetStyleProfileNode<ProfiledLayers>();
+  StyleProfileNode* alpha = GetStyleProfileNode<AlphaL<Red, SmoothStep<Int<12345>, Int<8000>>>>();
+  StyleProfileNode* smoothstep = GetStyleProfileNode<SmoothStep<Int<12345>, Int<8000>>>();
+  StyleProfileNode* blue = GetStyleProfileNode<Rgb<1, 2, 3>>();
+  if (!layers->called_ || layers->parent_ != nullptr ||
+      alpha->parent_ != layers || smoothstep->parent_ != alpha ||
+      blue->parent_ != layers) {
+    fprintf(stderr, "Style profile tree is wrong.\n");
+    exit(1);
+  }
+  if (layers->total_cycles() < alpha->total_cycles() ||
+      layers->child_cycles_ > layers->total_cycles() ||
+      alpha->run_cycles_ == 0 || alpha->color_cycles_ == 0) {
+    fprintf(stderr, "Style profile cycles are wrong.\n");
+    exit(1);
+  }
+  if (strncmp(alpha->name_, "AlphaL", alpha->short_name_length()) ||
+      alpha->short_name_length() != 6) {
+    fprintf(stderr, "Style profile name is wrong: %s\n", alpha->name_);
+    exit(1);
+  }
+  Print print;
+  stdout_output = &print;
+  DumpStyleProfile();
+  stdout_output = nullptr;
+  if (layers->total_cycles() != 0) {
+    fprintf(stderr, "Style profile should reset after dump.\n");
+    exit(1);
+  }
+}
+
 int main() {
   test_style4();
   test_cylon();
@@ -657,5 +849,9 @@ int main() {
   test_style1();
   test_style2();
   test_style3();
+  test_skip_frames();
+  test_constant_layers();
+  test_batch_colors();
+  test_style_profile();
   test_argument_parsing();
 }
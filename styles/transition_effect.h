@@ -58,7 +58,7 @@ class MultiTransitionEffectL {
 public:
   MultiTransitionEffectL() { for (size_t i = 0; i < N; i++) run_[i] = false; }
 
-void run(BladeBase* blade) {
+  LayerRunResult run(BladeBase* blade) {
     for (size_t i = 0; i < N; i++) 
     if (effect_.DetectScoped(blade)) {
       transitions_[pos_].begin();
@@ -67,14 +67,18 @@ void run(BladeBase* blade) {
       pos_++;
       if (pos_ >= N) pos_ = 0;
     }
+    bool running = false;
     for (size_t i = 0; i < N; i++) {
       if (run_[i]) {
 	last_detected_blade_effect = effects_[i];
 	transitions_[i].run(blade);
 	if (transitions_[i].done()) run_[i] = false;
+	running = true;
       }
     }
     last_detected_blade_effect = nullptr;
+    if (!running) return LayerRunResult::TRANSPARENT_UNTIL_IGNITION;
+    return LayerRunResult::UNKNOWN;
   }
   
 private: